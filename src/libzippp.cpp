@@ -37,10 +37,34 @@
    #define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#ifdef _WIN32
+   #define WIN32_LEAN_AND_MEAN
+   #define NOMINMAX
+   #include <windows.h>
+#else
+   #include <dirent.h>
+   #include <fcntl.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+#endif
+
 #include <zip.h>
+#include <zlib.h>
+#ifdef LIBZIPPP_WITH_LIBDEFLATE
+   #include <libdeflate.h>
+#endif
 #include <errno.h>
+#include <exception>
 #include <fstream>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstring>
+#include <algorithm>
 
 #include "libzippp.h"
 
@@ -52,6 +76,48 @@ using namespace std;
 
 #define NEW_CHAR_ARRAY(nb) new (std::nothrow) char[(nb)];
 
+// signatures and sizes of the ZIP format records (see APPNOTE.TXT)
+#define LIBZIPPP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define LIBZIPPP_LOCAL_HEADER_SIZE 30
+#define LIBZIPPP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define LIBZIPPP_CENTRAL_HEADER_SIZE 46
+#define LIBZIPPP_EOCD_SIGNATURE 0x06054b50
+#define LIBZIPPP_EOCD_SIZE 22
+#define LIBZIPPP_ZIP64_EOCD_SIGNATURE 0x06064b50
+#define LIBZIPPP_ZIP64_EOCD_SIZE 56
+#define LIBZIPPP_ZIP64_EOCD_LOCATOR_SIGNATURE 0x07064b50
+#define LIBZIPPP_ZIP64_EOCD_LOCATOR_SIZE 20
+#define LIBZIPPP_ZIP64_EXTRA_FIELD_ID 0x0001
+#define LIBZIPPP_MAX_COMMENT_LENGTH 0xFFFF
+
+// size of the deflate window (see RFC 1951) and of the compressed data read at once when inflating
+#define LIBZIPPP_INFLATE_WINDOW_SIZE 32768
+#define LIBZIPPP_INFLATE_INPUT_SIZE 16384
+
+// largest input or output given at once to zlib, whose lengths are 32 bits
+#define LIBZIPPP_ZLIB_MAX_LENGTH 0x40000000
+
+#define LIBZIPPP_DATA_DESCRIPTOR_SIGNATURE 0x08074b50
+#define LIBZIPPP_OPSYS_UNIX 3
+#define LIBZIPPP_DEFAULT_FILE_ATTRIBUTES 0100666u
+#define LIBZIPPP_DEFAULT_DIRECTORY_ATTRIBUTES 040777u
+
+//initial capacity of a writable buffer extended while reading back the archive
+#define LIBZIPPP_MIN_BUFFER_CAPACITY 1024
+
+//maximum amount of file data read ahead by ZipArchive::addDirectory while the archive is written
+#define LIBZIPPP_DIRECTORY_READ_AHEAD_SIZE 67108864
+
+//the entries larger than this size are compressed by libzip instead of the compression pool, which holds their
+//whole compressed data in memory until they are written
+#define LIBZIPPP_POOL_MAX_ENTRY_SIZE 67108864
+
+//maximum amount of compressed data held by the eager compression when no pending data limit is defined
+#define LIBZIPPP_EAGER_COMPRESSION_MAX_SIZE 268435456
+
+//the entries appended or streamed from this size have a Zip64 extra field, because their compressed size may exceed 4GB
+#define LIBZIPPP_ZIP64_THRESHOLD 0xFF000000ULL
+
 static libzippp_uint16 convertCompressionToLibzip(CompressionMethod comp) {
     switch(comp) {
         case CompressionMethod::STORE:
@@ -123,251 +189,2497 @@ namespace Helper {
         error_code_system = zip_error_code_system(error);
         callErrorHandlingCallbackFunc(msg, error_code_zip, error_code_system, callback);
     }
-}
-
-static void defaultErrorHandler(const std::string& message,
-                                const std::string& strerror,
-                                int /*zip_error_code*/,
-                                int /*system_error_code*/)
-{
-    fprintf(stderr, message.c_str(), strerror.c_str());
-}
-
-ZipEntry::ZipEntry(void) : zipFile(nullptr), index(0), time(0), compressionMethod(ZIP_CM_DEFAULT), compressionLevel(0), encryptionMethod(ZIP_EM_NONE), size(0), sizeComp(0), crc(0) {
-}
-
-string ZipEntry::getComment(void) const {
-    return zipFile->getEntryComment(*this);
-}
 
-bool ZipEntry::setComment(const string& str) const {
-    return zipFile->setEntryComment(*this, str);
-}
+    //anonymous temporary file in the given directory (or the one of the system), removed once closed
+    static FILE* createTempFile(const string& directory) {
+        if (directory.empty()) { return tmpfile(); }
+#ifdef _WIN32
+        char path[MAX_PATH];
+        if (GetTempFileNameA(directory.c_str(), "zpp", 0, path)==0) { return nullptr; }
+        return fopen(path, "w+bD"); //D: deleted when closed
+#else
+        string pattern = directory + "/libzippp-XXXXXX";
+        vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        int fd = mkstemp(path.data());
+        if (fd<0) { return nullptr; }
+        ::unlink(path.data()); //the data remains available until the file is closed
+        FILE* file = fdopen(fd, "w+b");
+        if (file==nullptr) { ::close(fd); }
+        return file;
+#endif
+    }
 
-bool ZipEntry::setCompressionMethod(CompressionMethod compMethod) {
-    return zipFile->setEntryCompressionConfig(*this, compMethod, compressionLevel);
-}
+    //writes the data in a temporary file, positioned at its beginning
+    static FILE* spillData(const string& directory, const void* data, libzippp_uint64 length) {
+        FILE* file = createTempFile(directory);
+        if (file==nullptr) { return nullptr; }
+        const char* bytes = static_cast<const char*>(data);
+        for(libzippp_uint64 written=0 ; written<length ; ) {
+            size_t chunk = length-written<LIBZIPPP_DEFAULT_CHUNK_SIZE ? (size_t)(length-written) : LIBZIPPP_DEFAULT_CHUNK_SIZE;
+            if (fwrite(bytes+written, 1, chunk, file)!=chunk) {
+                fclose(file);
+                return nullptr;
+            }
+            written += chunk;
+        }
+        if (fflush(file)!=0) {
+            fclose(file);
+            return nullptr;
+        }
+        rewind(file);
+        return file;
+    }
 
-CompressionMethod ZipEntry::getCompressionMethod(void) const {
-    return convertCompressionFromLibzip(compressionMethod);
-}
+    //maps the whole file in memory (read-only), returns null and sets the system error code on failure
+    static void* mapFile(const std::string& path, libzippp_uint64* length, int* systemError) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file==INVALID_HANDLE_VALUE) {
+            *systemError = (int)GetLastError();
+            return nullptr;
+        }
 
-bool ZipEntry::setCompressionLevel(libzippp_uint32 level) {
-    return zipFile->setEntryCompressionConfig(*this, convertCompressionFromLibzip(compressionMethod), level);
-}
+        void* data = nullptr;
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart>0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping!=nullptr) {
+                data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping); //the view keeps the mapping alive
+            }
+        }
+        if (data==nullptr) { *systemError = (int)GetLastError(); }
+        else { *length = (libzippp_uint64)fileSize.QuadPart; }
+        CloseHandle(file);
+        return data;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd<0) {
+            *systemError = errno;
+            return nullptr;
+        }
 
-string ZipEntry::readAsText(ZipArchive::State state, libzippp_uint64 size) const {
-    char* content = (char*)zipFile->readEntry(*this, true, state, size);
-    if (content==nullptr) { return string(); } //happen if the ZipArchive has been closed
+        void* data = nullptr;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat)!=0) {
+            *systemError = errno;
+        } else if (fileStat.st_size<=0) {
+            *systemError = EINVAL; //an empty file can't be mapped
+        } else {
+            data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data==MAP_FAILED) {
+                *systemError = errno;
+                data = nullptr;
+            } else {
+                *length = (libzippp_uint64)fileStat.st_size;
+            }
+        }
+        ::close(fd); //the mapping remains valid once the file is closed
+        return data;
+#endif
+    }
 
-    libzippp_uint64 maxSize = getSize();
-    string str(content, (size==0 || size>maxSize ? maxSize : size));
-    delete[] content;
-    return str;
-}
+    static void unmapFile(void* data, libzippp_uint64 length) {
+#ifdef _WIN32
+        (void)length;
+        UnmapViewOfFile(data);
+#else
+        munmap(data, (size_t)length);
+#endif
+    }
 
-libzippp_uint8* ZipEntry::readAsBinary(ZipArchive::State state, libzippp_uint64 size) const {
-    return (libzippp_uint8*)zipFile->readEntry(*this, false, state, size);
-}
+    //cuts a file to the given length, returns false if it fails
+    static bool truncateFile(const string& path, libzippp_uint64 length, int* systemError) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file==INVALID_HANDLE_VALUE) {
+            *systemError = (int)GetLastError();
+            return false;
+        }
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)length;
+        bool truncated = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+        if (!truncated) { *systemError = (int)GetLastError(); }
+        CloseHandle(file);
+        return truncated;
+#else
+        if (truncate(path.c_str(), (off_t)length)!=0) {
+            *systemError = errno;
+            return false;
+        }
+        return true;
+#endif
+    }
 
-basic_string<libzippp_uint8> ZipEntry::readAsBinaryString(ZipArchive::State state, libzippp_uint64 size) const {
-    libzippp_uint8* content = (libzippp_uint8*)zipFile->readEntry(*this, true, state, size);
-    if (content==nullptr) { return basic_string<libzippp_uint8>(); } //happen if the ZipArchive has been closed
+    //file or directory found while walking a tree, named relatively to its root with '/' as separator
+    struct DirectoryItem {
+        DirectoryItem(const string& p) : path(p), directory(false), file(false), size(0), mtime(0), mode(0) {}
+
+        string path;
+        bool directory;
+        bool file;
+        libzippp_uint64 size;
+        time_t mtime;
+        libzippp_uint32 mode; //Unix mode, zero if unknown
+    };
+
+    //names of the items of a directory (except . and ..), returns false if it can't be read
+    static bool listDirectory(const string& path, vector<string>& names) {
+#ifdef _WIN32
+        WIN32_FIND_DATAA data;
+        HANDLE handle = FindFirstFileA((path + "\\*").c_str(), &data);
+        if (handle==INVALID_HANDLE_VALUE) { return false; }
+        do {
+            string name = data.cFileName;
+            if (name!="." && name!="..") { names.push_back(name); }
+        } while (FindNextFileA(handle, &data));
+        FindClose(handle);
+        return true;
+#else
+        DIR* dir = opendir(path.c_str());
+        if (dir==nullptr) { return false; }
+        struct dirent* item;
+        while ((item = readdir(dir))!=nullptr) {
+            string name = item->d_name;
+            if (name!="." && name!="..") { names.push_back(name); }
+        }
+        closedir(dir);
+        return true;
+#endif
+    }
 
-    libzippp_uint64 maxSize = getSize();
-    basic_string<libzippp_uint8> str(content, (size==0 || size>maxSize ? maxSize : size));
-    delete[] content;
-    return str;
-}
+    //the links to directories are neither files nor directories, hence they are not followed (no cycles)
+    static void statItem(const string& path, DirectoryItem& item) {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) { return; }
+        bool link = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)!=0;
+        bool directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)!=0;
+        ULARGE_INTEGER mtime; //100ns intervals since 1601
+        mtime.LowPart = data.ftLastWriteTime.dwLowDateTime;
+        mtime.HighPart = data.ftLastWriteTime.dwHighDateTime;
+        item.directory = directory && !link;
+        item.file = !directory;
+        item.size = ((libzippp_uint64)data.nFileSizeHigh<<32) | data.nFileSizeLow;
+        item.mtime = (time_t)((mtime.QuadPart-116444736000000000ULL)/10000000ULL);
+#else
+        struct stat itemStat;
+        if (lstat(path.c_str(), &itemStat)!=0) { return; }
+        bool link = S_ISLNK(itemStat.st_mode);
+        if (link && stat(path.c_str(), &itemStat)!=0) { return; } //dangling link
+        item.directory = S_ISDIR(itemStat.st_mode) && !link;
+        item.file = S_ISREG(itemStat.st_mode);
+        item.size = (libzippp_uint64)itemStat.st_size;
+        item.mtime = itemStat.st_mtime;
+        item.mode = (libzippp_uint32)itemStat.st_mode;
+#endif
+    }
 
-int ZipEntry::readContent(std::ostream& ofOutput, ZipArchive::State state, libzippp_uint64 chunksize) const {
-   return zipFile->readEntry(*this, ofOutput, state, chunksize);
-}
+    //stats the items concurrently, their paths being relative to the root
+    static void statItems(const string& root, vector<DirectoryItem>& items, libzippp_uint32 nbThreads) {
+        std::atomic<size_t> nextItem(0);
+        auto worker = [&]() {
+            size_t i;
+            while ((i = nextItem++)<items.size()) { statItem(root + "/" + items[i].path, items[i]); }
+        };
+
+        if (nbThreads>items.size()) { nbThreads = (libzippp_uint32)items.size(); }
+        if (nbThreads<=1) {
+            worker();
+        } else {
+            vector<std::thread> threads;
+            for(libzippp_uint32 i=0 ; i<nbThreads ; ++i) { threads.push_back(std::thread(worker)); }
+            for(vector<std::thread>::iterator it=threads.begin() ; it!=threads.end() ; ++it) { it->join(); }
+        }
+    }
 
-ZipArchive::ZipArchive(const string& zipPath, const string& password, Encryption encryptionMethod) : path(zipPath), zipHandle(nullptr), zipSource(nullptr), mode(NotOpen), password(password), progressPrecision(LIBZIPPP_DEFAULT_PROGRESSION_PRECISION), bufferData(nullptr), bufferLength(0), useArchiveCompressionMethod(false), compressionMethod(ZIP_CM_DEFAULT), compressionLevel(0), errorHandlingCallback(defaultErrorHandler) {
-    switch(encryptionMethod) {
-#ifdef LIBZIPPP_WITH_ENCRYPTION
-        case Encryption::Aes128:
-            this->encryptionMethod = ZIP_EM_AES_128;
-            break;
-        case Encryption::Aes192:
-            this->encryptionMethod = ZIP_EM_AES_192;
-            break;
-        case Encryption::Aes256:
-            this->encryptionMethod = ZIP_EM_AES_256;
-            break;
-        case Encryption::TradPkware:
-            this->encryptionMethod = ZIP_EM_TRAD_PKWARE;
-            break;
+    //size and Unix mode of a file (the mode is zero if unknown), returns false if it can't be stat'ed
+    static bool statFile(const string& path, libzippp_uint64* size, libzippp_uint32* mode) {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) { return false; }
+        *size = ((libzippp_uint64)data.nFileSizeHigh<<32) | data.nFileSizeLow;
+        *mode = 0;
+#else
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat)!=0) { return false; }
+        *size = (libzippp_uint64)fileStat.st_size;
+        *mode = (libzippp_uint32)fileStat.st_mode;
 #endif
-        case Encryption::None:
-        default:
-            this->encryptionMethod = ZIP_EM_NONE;
-            break;
+        return true;
     }
-}
-
-ZipArchive::~ZipArchive(void) {
-    close(); /* discard ??? */
 
-    // ensures all the values are clared
-    zipHandle = nullptr;
-    zipSource = nullptr;
-    bufferData = nullptr;
-    errorHandlingCallback = nullptr;
-    listeners.clear();
-}
+    //external attributes of an entry added from a Unix file, as computed by the file sources of libzip
+    //(the low byte holds the MS-DOS read-only flag)
+    static libzippp_uint32 fileAttributes(libzippp_uint32 mode) {
+        return (mode<<16) | ((mode & 0200) ? 0 : 1);
+    }
 
-void ZipArchive::free(ZipArchive* archive) {
-    delete archive;
-}
+    //answers ZIP_SOURCE_GET_FILE_ATTRIBUTES for a source whose Unix mode is known
+    static bool getFileAttributes(libzippp_uint32 mode, void* data, libzippp_uint64 len) {
+        if (len<sizeof(zip_file_attributes_t)) { return false; }
+        zip_file_attributes_t* attributes = static_cast<zip_file_attributes_t*>(data);
+        if (mode!=0) {
+            attributes->valid |= ZIP_FILE_ATTRIBUTES_HOST_SYSTEM | ZIP_FILE_ATTRIBUTES_EXTERNAL_FILE_ATTRIBUTES;
+            attributes->host_system = ZIP_OPSYS_UNIX;
+            attributes->external_file_attributes = fileAttributes(mode);
+        }
+        return true;
+    }
 
-ZipArchive* ZipArchive::fromBuffer(const void* data, libzippp_uint32 size, bool checkConsistency,
-                                   const std::string& password, Encryption encryptionMethod) {
-    void* mutableData = const_cast<void*>(data);
-    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
-    bool o = za->openBuffer(&mutableData, size, ZipArchive::ReadOnly, checkConsistency);
-    if (!o) {
-        delete za;
-        za = nullptr;
+    static libzippp_uint16 readUInt16(const libzippp_uint8* p) {
+        return (libzippp_uint16)(p[0] | (p[1]<<8));
     }
-    return za;
-}
 
-ZipArchive* ZipArchive::fromWritableBuffer(void** data, libzippp_uint32 size, OpenMode mode, bool checkConsistency,
-                                           const std::string& password, Encryption encryptionMethod) {
-    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
-    bool o = za->openBuffer(data, size, mode, checkConsistency);
-    if (!o) {
-        delete za;
-        za = nullptr;
+    static libzippp_uint32 readUInt32(const libzippp_uint8* p) {
+        return (libzippp_uint32)p[0] | ((libzippp_uint32)p[1]<<8) | ((libzippp_uint32)p[2]<<16) | ((libzippp_uint32)p[3]<<24);
     }
-    return za;
-}
 
-ZipArchive* ZipArchive::fromSource(zip_source* source, OpenMode om, bool checkConsistency,
-                                   const std::string& password, Encryption encryptionMethod) {
-    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
-    bool o = za->openSource(source, om, checkConsistency);
-    if (!o) {
-        delete za;
-        za = nullptr;
+    static libzippp_uint64 readUInt64(const libzippp_uint8* p) {
+        return (libzippp_uint64)readUInt32(p) | ((libzippp_uint64)readUInt32(p+4)<<32);
     }
-    return za;
-}
 
-bool ZipArchive::openBuffer(void** data, libzippp_uint32 size, OpenMode om, bool checkConsistency) {
-    zip_error_t error;
-    zip_error_init(&error);
+    static void writeUInt16(vector<libzippp_uint8>& out, libzippp_uint16 v) {
+        out.push_back((libzippp_uint8)v);
+        out.push_back((libzippp_uint8)(v>>8));
+    }
 
-    /* create source from buffer */
-    zip_source* localZipSource = zip_source_buffer_create(*data, size, 0, &error);
-    if (localZipSource == nullptr) {
-        Helper::callErrorHandlingCallback(&error, "can't create zip source: %s\n", errorHandlingCallback);
-        zip_error_fini(&error);
-        return false;
+    static void writeUInt32(vector<libzippp_uint8>& out, libzippp_uint32 v) {
+        writeUInt16(out, (libzippp_uint16)v);
+        writeUInt16(out, (libzippp_uint16)(v>>16));
     }
 
-    bool open = openSource(localZipSource, om, checkConsistency);
-    if (open) {
-        if (om==Write || om==New) {
-            bufferData = data;
-            bufferLength = size;
+    static void writeUInt64(vector<libzippp_uint8>& out, libzippp_uint64 v) {
+        writeUInt32(out, (libzippp_uint32)v);
+        writeUInt32(out, (libzippp_uint32)(v>>32));
+    }
 
-            //prevents libzip to delete the source when closing the ZipArchive
-            zip_source_keep(localZipSource);
+    //MS-DOS time and date of the local time, as written by libzip
+    static void toDosDateTime(time_t t, libzippp_uint16* dosTime, libzippp_uint16* dosDate) {
+        struct tm* tm = localtime(&t);
+        if (tm==nullptr || tm->tm_year<80) {
+            *dosTime = 0;
+            *dosDate = (1<<5) | 1; //1980-01-01
+            return;
         }
-    } else {
-        zip_source_free(localZipSource);
-        localZipSource = nullptr;
+        *dosTime = (libzippp_uint16)((tm->tm_hour<<11) | (tm->tm_min<<5) | (tm->tm_sec>>1));
+        *dosDate = (libzippp_uint16)(((tm->tm_year-80)<<9) | ((tm->tm_mon+1)<<5) | tm->tm_mday);
     }
-    return open;
-}
 
-bool ZipArchive::openSource(zip_source* source, OpenMode om, bool checkConsistency) {
-    int zipFlag = 0;
-    if (om == ReadOnly) { zipFlag = 0; }
-    else if (om == Write) { zipFlag = ZIP_CREATE; }
-    else if (om == New) { zipFlag = ZIP_CREATE | ZIP_TRUNCATE; }
-    else { return false; }
-    if (checkConsistency) {
-        zipFlag = zipFlag | ZIP_CHECKCONS;
+    static time_t fromDosDateTime(libzippp_uint16 dosTime, libzippp_uint16 dosDate) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_isdst = -1;
+        tm.tm_year = ((dosDate>>9) & 127) + 80;
+        tm.tm_mon = ((dosDate>>5) & 15) - 1;
+        tm.tm_mday = dosDate & 31;
+        tm.tm_hour = (dosTime>>11) & 31;
+        tm.tm_min = (dosTime>>5) & 63;
+        tm.tm_sec = (dosTime<<1) & 62;
+        return mktime(&tm);
     }
 
-    zip_error_t error;
-    zip_error_init(&error);
+    //local header of an entry whose CRC and sizes are not known yet (written afterwards or in a data descriptor)
+    static void writeLocalHeader(vector<libzippp_uint8>& out, const string& name, bool zip64, libzippp_uint16 flags, libzippp_uint16 method, time_t mtime) {
+        libzippp_uint16 dosTime, dosDate;
+        toDosDateTime(mtime, &dosTime, &dosDate);
+
+        writeUInt32(out, LIBZIPPP_LOCAL_HEADER_SIGNATURE);
+        writeUInt16(out, zip64 ? 45 : 20);
+        writeUInt16(out, flags);
+        writeUInt16(out, method);
+        writeUInt16(out, dosTime);
+        writeUInt16(out, dosDate);
+        writeUInt32(out, 0);
+        writeUInt32(out, zip64 ? 0xFFFFFFFF : 0);
+        writeUInt32(out, zip64 ? 0xFFFFFFFF : 0);
+        writeUInt16(out, (libzippp_uint16)name.size());
+        writeUInt16(out, zip64 ? 20 : 0);
+        out.insert(out.end(), name.begin(), name.end());
+        if (zip64) {
+            writeUInt16(out, LIBZIPPP_ZIP64_EXTRA_FIELD_ID);
+            writeUInt16(out, 16);
+            writeUInt64(out, 0);
+            writeUInt64(out, 0);
+        }
+    }
 
-    /* open zip archive from source */
-    zipHandle = zip_open_from_source(source, zipFlag, &error);
-    if (zipHandle == nullptr) {
-        Helper::callErrorHandlingCallback(&error, "can't open zip from source: %s\n", errorHandlingCallback);
-        zip_error_fini(&error);
-        return false;
+    //central directory record of an entry, with a Zip64 extra field holding only the values that overflow
+    static void writeCentralRecord(vector<libzippp_uint8>& out, const string& name, libzippp_uint8 opsys, bool zip64, libzippp_uint16 flags, libzippp_uint16 method, time_t mtime, libzippp_uint32 crc, libzippp_uint64 compSize, libzippp_uint64 size, libzippp_uint32 attributes, libzippp_uint64 offset) {
+        vector<libzippp_uint8> extra;
+        if (size>=0xFFFFFFFF) { writeUInt64(extra, size); }
+        if (compSize>=0xFFFFFFFF) { writeUInt64(extra, compSize); }
+        if (offset>=0xFFFFFFFF) { writeUInt64(extra, offset); }
+        libzippp_uint16 version = (zip64 || !extra.empty()) ? 45 : 20;
+        libzippp_uint16 dosTime, dosDate;
+        toDosDateTime(mtime, &dosTime, &dosDate);
+
+        writeUInt32(out, LIBZIPPP_CENTRAL_HEADER_SIGNATURE);
+        writeUInt16(out, (libzippp_uint16)((opsys<<8) | version));
+        writeUInt16(out, version);
+        writeUInt16(out, flags);
+        writeUInt16(out, method);
+        writeUInt16(out, dosTime);
+        writeUInt16(out, dosDate);
+        writeUInt32(out, crc);
+        writeUInt32(out, (libzippp_uint32)(compSize<0xFFFFFFFF ? compSize : 0xFFFFFFFF));
+        writeUInt32(out, (libzippp_uint32)(size<0xFFFFFFFF ? size : 0xFFFFFFFF));
+        writeUInt16(out, (libzippp_uint16)name.size());
+        writeUInt16(out, (libzippp_uint16)(extra.empty() ? 0 : extra.size()+4));
+        writeUInt16(out, 0); //comment
+        writeUInt16(out, 0); //disk
+        writeUInt16(out, 0); //internal attributes
+        writeUInt32(out, attributes);
+        writeUInt32(out, (libzippp_uint32)(offset<0xFFFFFFFF ? offset : 0xFFFFFFFF));
+        out.insert(out.end(), name.begin(), name.end());
+        if (!extra.empty()) {
+            writeUInt16(out, LIBZIPPP_ZIP64_EXTRA_FIELD_ID);
+            writeUInt16(out, (libzippp_uint16)extra.size());
+            out.insert(out.end(), extra.begin(), extra.end());
+        }
     }
-    zip_error_fini(&error);
 
-    zipSource = source;
+    //end of central directory record, preceded by the Zip64 ones if needed
+    static void writeEndRecords(vector<libzippp_uint8>& out, libzippp_uint64 nbEntries, libzippp_uint64 cdOffset, libzippp_uint64 cdSize, const char* comment, libzippp_uint16 commentLength) {
+        if (nbEntries>=0xFFFF || cdOffset>=0xFFFFFFFF || cdSize>=0xFFFFFFFF) {
+            writeUInt32(out, LIBZIPPP_ZIP64_EOCD_SIGNATURE);
+            writeUInt64(out, LIBZIPPP_ZIP64_EOCD_SIZE-12); //size of the remaining record
+            writeUInt16(out, 45);
+            writeUInt16(out, 45);
+            writeUInt32(out, 0);
+            writeUInt32(out, 0);
+            writeUInt64(out, nbEntries);
+            writeUInt64(out, nbEntries);
+            writeUInt64(out, cdSize);
+            writeUInt64(out, cdOffset);
+
+            writeUInt32(out, LIBZIPPP_ZIP64_EOCD_LOCATOR_SIGNATURE);
+            writeUInt32(out, 0);
+            writeUInt64(out, cdOffset+cdSize);
+            writeUInt32(out, 1);
+        }
+        writeUInt32(out, LIBZIPPP_EOCD_SIGNATURE);
+        writeUInt16(out, 0);
+        writeUInt16(out, 0);
+        writeUInt16(out, (libzippp_uint16)(nbEntries<0xFFFF ? nbEntries : 0xFFFF));
+        writeUInt16(out, (libzippp_uint16)(nbEntries<0xFFFF ? nbEntries : 0xFFFF));
+        writeUInt32(out, (libzippp_uint32)(cdSize<0xFFFFFFFF ? cdSize : 0xFFFFFFFF));
+        writeUInt32(out, (libzippp_uint32)(cdOffset<0xFFFFFFFF ? cdOffset : 0xFFFFFFFF));
+        writeUInt16(out, commentLength);
+        out.insert(out.end(), comment, comment+commentLength);
+    }
 
-#ifdef LIBZIPPP_WITH_ENCRYPTION
-    if (isEncrypted()) {
-        int result = zip_set_default_password(zipHandle, password.c_str());
-        if (result != 0) {
-            close();
-            return false;
+    //true if the name has non-ASCII characters, which are written as UTF-8 by libzip and libzippp
+    static bool isUtf8Name(const string& name) {
+        for(string::const_iterator it=name.begin() ; it!=name.end() ; ++it) {
+            if ((libzippp_uint8)*it>=0x80) { return true; }
         }
+        return false;
     }
-#endif
 
-    mode = om;
-    return true;
-}
+    //compresses (raw deflate with the default level of libzip) or stores the data provided by readFunc, which returns
+    //zero at the end of the data, and computes its size and CRC
+    static bool deflateData(const std::function<libzippp_int64(void*,libzippp_uint64)>& readFunc, const std::function<bool(const void*,libzippp_uint64)>& writeFunc, bool store, libzippp_uint64* size, libzippp_uint32* crc) {
+        vector<libzippp_uint8> input(LIBZIPPP_INFLATE_INPUT_SIZE*4);
+        vector<libzippp_uint8> output(LIBZIPPP_INFLATE_INPUT_SIZE*4);
+        uLong checksum = crc32(0L, Z_NULL, 0);
+        *size = 0;
+
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (!store && deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)!=Z_OK) { return false; }
+
+        bool success = true;
+        int flush = Z_NO_FLUSH;
+        int result = Z_OK;
+        while (success && result!=Z_STREAM_END) {
+            if (stream.avail_in==0 && flush==Z_NO_FLUSH) {
+                libzippp_int64 nread = readFunc(input.data(), input.size());
+                if (nread<0) { success = false; break; }
+                if (nread==0) { flush = Z_FINISH; }
+                checksum = crc32(checksum, input.data(), (uInt)nread);
+                *size += nread;
+                stream.next_in = input.data();
+                stream.avail_in = (uInt)nread;
+            }
 
-bool ZipArchive::open(OpenMode om, bool checkConsistency) {
-    if (isOpen()) { return om==mode; }
+            if (store) {
+                success = stream.avail_in==0 || writeFunc(stream.next_in, stream.avail_in);
+                stream.avail_in = 0;
+                if (flush==Z_FINISH) { result = Z_STREAM_END; }
+                continue;
+            }
 
-    int zipFlag = 0;
-    if (om==ReadOnly) { zipFlag = 0; }
-    else if (om==Write) { zipFlag = ZIP_CREATE; }
-    else if (om==New) { zipFlag = ZIP_CREATE | ZIP_TRUNCATE; }
-    else { return false; }
+            stream.next_out = output.data();
+            stream.avail_out = (uInt)output.size();
+            result = deflate(&stream, flush);
+            libzippp_uint64 produced = output.size()-stream.avail_out;
+            if (result==Z_STREAM_ERROR) { success = false; }
+            else if (produced>0) { success = writeFunc(output.data(), produced); }
+        }
 
-    if (checkConsistency) {
-        zipFlag = zipFlag | ZIP_CHECKCONS;
+        if (!store) { deflateEnd(&stream); }
+        *crc = (libzippp_uint32)checksum;
+        return success;
     }
 
-    int errorFlag = 0;
-    zipHandle = zip_open(path.c_str(), zipFlag, &errorFlag);
-
-    //error during opening of the file
-    if (errorFlag!=ZIP_ER_OK) {
-        zip_error_t error;
-        zip_error_init_with_code(&error, errorFlag);
-        Helper::callErrorHandlingCallback(&error, "unable to open archive: %s\n", errorHandlingCallback);
-        zip_error_fini(&error);
+    //finds the central directory of the archive held in data (handles Zip64 archives)
+    static bool locateCentralDirectory(const libzippp_uint8* data, libzippp_uint64 length, libzippp_uint64* cdOffset, libzippp_uint64* cdSize, libzippp_uint64* nbEntries) {
+        if (length<LIBZIPPP_EOCD_SIZE) { return false; }
 
-        zipHandle = nullptr;
-        return false;
-    }
+        //the end of central directory record is followed by a comment of at most 64KB
+        libzippp_uint64 lowest = length>LIBZIPPP_EOCD_SIZE+LIBZIPPP_MAX_COMMENT_LENGTH ? length-LIBZIPPP_EOCD_SIZE-LIBZIPPP_MAX_COMMENT_LENGTH : 0;
+        libzippp_uint64 eocd = length-LIBZIPPP_EOCD_SIZE;
+        while (readUInt32(data+eocd)!=LIBZIPPP_EOCD_SIGNATURE) {
+            if (eocd==lowest) { return false; }
+            --eocd;
+        }
 
-    if (zipHandle!=nullptr) {
-#ifdef LIBZIPPP_WITH_ENCRYPTION
-        if (isEncrypted()) {
-            int result = zip_set_default_password(zipHandle, password.c_str());
-            if (result!=0) {
-                close();
-                return false;
+        *nbEntries = readUInt16(data+eocd+10);
+        *cdSize = readUInt32(data+eocd+12);
+        *cdOffset = readUInt32(data+eocd+16);
+
+        if (eocd>=LIBZIPPP_ZIP64_EOCD_LOCATOR_SIZE) {
+            const libzippp_uint8* locator = data+eocd-LIBZIPPP_ZIP64_EOCD_LOCATOR_SIZE;
+            if (readUInt32(locator)==LIBZIPPP_ZIP64_EOCD_LOCATOR_SIGNATURE) {
+                libzippp_uint64 eocd64 = readUInt64(locator+8);
+                if (length<LIBZIPPP_ZIP64_EOCD_SIZE || eocd64>length-LIBZIPPP_ZIP64_EOCD_SIZE || readUInt32(data+eocd64)!=LIBZIPPP_ZIP64_EOCD_SIGNATURE) { return false; }
+                *nbEntries = readUInt64(data+eocd64+32);
+                *cdSize = readUInt64(data+eocd64+40);
+                *cdOffset = readUInt64(data+eocd64+48);
             }
         }
-#endif
 
-        mode = om;
-        return true;
+        return *cdOffset<=length && *cdSize<=length-*cdOffset;
     }
 
-    return false;
-}
-
-void progress_callback(zip* /*archive*/, double progression, void* ud) {
+    //reads the offsets of all the local headers from the central directory of the archive held in data
+    static bool readLocalHeaderOffsets(const libzippp_uint8* data, libzippp_uint64 length, vector<libzippp_uint64>& offsets) {
+        libzippp_uint64 cdOffset, cdSize, nbEntries;
+        if (!locateCentralDirectory(data, length, &cdOffset, &cdSize, &nbEntries)) { return false; }
+        if (nbEntries>cdSize/LIBZIPPP_CENTRAL_HEADER_SIZE) { return false; }
+
+        offsets.clear();
+        offsets.reserve(nbEntries);
+        const libzippp_uint8* cd = data+cdOffset;
+        libzippp_uint64 pos = 0;
+        for(libzippp_uint64 i=0 ; i<nbEntries ; ++i) {
+            if (cdSize-pos<LIBZIPPP_CENTRAL_HEADER_SIZE) { return false; }
+            const libzippp_uint8* header = cd+pos;
+            if (readUInt32(header)!=LIBZIPPP_CENTRAL_HEADER_SIGNATURE) { return false; }
+
+            libzippp_uint16 nameLength = readUInt16(header+28);
+            libzippp_uint16 extraLength = readUInt16(header+30);
+            libzippp_uint16 commentLength = readUInt16(header+32);
+            libzippp_uint64 recordSize = LIBZIPPP_CENTRAL_HEADER_SIZE+nameLength+extraLength+commentLength;
+            if (cdSize-pos<recordSize) { return false; }
+
+            libzippp_uint64 offset = readUInt32(header+42);
+            if (offset==0xFFFFFFFF) {
+                //the actual value is in the Zip64 extra field, after the sizes that overflow as well
+                const libzippp_uint8* extra = header+LIBZIPPP_CENTRAL_HEADER_SIZE+nameLength;
+                const libzippp_uint8* extraEnd = extra+extraLength;
+                while (extra+4<=extraEnd) {
+                    libzippp_uint16 fieldId = readUInt16(extra);
+                    libzippp_uint16 fieldSize = readUInt16(extra+2);
+                    if (extra+4+fieldSize>extraEnd) { return false; }
+                    if (fieldId==LIBZIPPP_ZIP64_EXTRA_FIELD_ID) {
+                        libzippp_uint16 fieldPos = 0;
+                        if (readUInt32(header+24)==0xFFFFFFFF) { fieldPos += 8; }
+                        if (readUInt32(header+20)==0xFFFFFFFF) { fieldPos += 8; }
+                        if (fieldPos+8>fieldSize) { return false; }
+                        offset = readUInt64(extra+4+fieldPos);
+                        break;
+                    }
+                    extra += 4+fieldSize;
+                }
+            }
+
+            offsets.push_back(offset);
+            pos += recordSize;
+        }
+        return true;
+    }
+
+    //case-insensitive FNV-1a hash, hence it can be used for any kind of lookup
+    static libzippp_uint64 hashEntryName(const char* name, libzippp_uint64 length) {
+        libzippp_uint64 hash = 14695981039346656037ULL;
+        for(libzippp_uint64 i=0 ; i<length ; ++i) {
+            char c = name[i];
+            if (c>='A' && c<='Z') { c = (char)(c-'A'+'a'); }
+            hash = (hash ^ (libzippp_uint8)c) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    //compares a null-terminated entry name with the given name of the specified length
+    static bool entryNameEquals(const char* entryName, const char* name, libzippp_uint64 length, bool caseSensitive) {
+        for(libzippp_uint64 i=0 ; i<length ; ++i) {
+            char c1 = entryName[i];
+            char c2 = name[i];
+            if (c1=='\0') { return false; }
+            if (!caseSensitive) {
+                if (c1>='A' && c1<='Z') { c1 = (char)(c1-'A'+'a'); }
+                if (c2>='A' && c2<='Z') { c2 = (char)(c2-'A'+'a'); }
+            }
+            if (c1!=c2) { return false; }
+        }
+        return entryName[length]=='\0';
+    }
+
+    // '?' matches any character but '/', '*' any sequence without '/' and '**' any sequence
+    static bool matchPattern(const char* pattern, const char* patternEnd, const char* name, const char* nameEnd) {
+        while (pattern<patternEnd) {
+            if (*pattern=='*') {
+                bool anyDirectory = pattern+1<patternEnd && pattern[1]=='*';
+                pattern += anyDirectory ? 2 : 1;
+                for(const char* c=name ; ; ++c) {
+                    if (matchPattern(pattern, patternEnd, c, nameEnd)) { return true; }
+                    if (c==nameEnd) { return false; }
+                    if (*c==LIBZIPPP_ENTRY_PATH_SEPARATOR && !anyDirectory) { return false; }
+                }
+            }
+
+            if (name==nameEnd) { return false; }
+            if (*pattern=='?') {
+                if (*name==LIBZIPPP_ENTRY_PATH_SEPARATOR) { return false; }
+            } else if (*pattern!=*name) {
+                return false;
+            }
+            ++pattern;
+            ++name;
+        }
+        return name==nameEnd;
+    }
+
+    //resizes the output (string or vector) to the size to read and reads the entry directly into it
+    template<class T>
+    static int readEntryInto(const ZipArchive& zipArchive, const ZipEntry& zipEntry, T& output, ZipArchive::State state, libzippp_uint64 size) {
+        if (!zipArchive.isOpen()) { output.clear(); return LIBZIPPP_ERROR_NOT_OPEN; }
+
+        libzippp_uint64 maxSize = zipEntry.getSize();
+        libzippp_uint64 length = size==0 || size>maxSize ? maxSize : size;
+        output.resize(length);
+        if (length==0) { return LIBZIPPP_OK; }
+
+        libzippp_int64 result = zipArchive.readEntryInto(zipEntry, &output[0], length, state);
+        if (result<0) {
+            output.clear();
+            return (int)result;
+        }
+        return LIBZIPPP_OK;
+    }
+
+    //reads length bytes at offset within an open entry, by seeking if possible or by skipping the previous data
+    static libzippp_int64 readFileRange(struct zip_file* zipFile, libzippp_uint64 offset, void* buffer, libzippp_uint64 length) {
+        if (offset>0 && (zip_file_is_seekable(zipFile)!=1 || zip_fseek(zipFile, (zip_int64_t)offset, SEEK_SET)!=0)) {
+            std::vector<libzippp_uint8> skipped(LIBZIPPP_INFLATE_WINDOW_SIZE);
+            while (offset>0) {
+                libzippp_uint64 toSkip = offset<skipped.size() ? offset : skipped.size();
+                libzippp_int64 result = zip_fread(zipFile, skipped.data(), toSkip);
+                if (result<=0) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+                offset -= result;
+            }
+        }
+
+        libzippp_int64 result = zip_fread(zipFile, buffer, length);
+        if (result<0 || (libzippp_uint64)result!=length) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+        return result;
+    }
+
+    //inflates the raw deflate data of zipFile, skips the first skip bytes and writes the next length ones in buffer
+    static libzippp_int64 inflateRange(struct zip_file* zipFile, z_stream* stream, libzippp_uint64 skip, void* buffer, libzippp_uint64 length) {
+        std::vector<libzippp_uint8> input(LIBZIPPP_INFLATE_INPUT_SIZE);
+        std::vector<libzippp_uint8> skipped(skip>0 ? LIBZIPPP_INFLATE_WINDOW_SIZE : 0);
+        libzippp_uint8* output = static_cast<libzippp_uint8*>(buffer);
+        libzippp_uint64 done = 0;
+
+        while (done<length) {
+            if (stream->avail_in==0) { //at the end of the data, inflate fails if it can't make any progress
+                libzippp_int64 nread = zip_fread(zipFile, input.data(), input.size());
+                if (nread<0) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+                stream->avail_in = (uInt)nread;
+                stream->next_in = input.data();
+            }
+
+            libzippp_uint64 requested;
+            if (skip>0) {
+                requested = skip<skipped.size() ? skip : skipped.size();
+                stream->next_out = skipped.data();
+            } else {
+                requested = length-done<LIBZIPPP_DEFAULT_CHUNK_SIZE ? length-done : LIBZIPPP_DEFAULT_CHUNK_SIZE;
+                stream->next_out = output+done;
+            }
+            stream->avail_out = (uInt)requested;
+
+            int result = inflate(stream, Z_NO_FLUSH);
+            if (result!=Z_OK && result!=Z_STREAM_END) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+
+            libzippp_uint64 produced = requested-stream->avail_out;
+            if (skip>0) { skip -= produced; }
+            else { done += produced; }
+            if (result==Z_STREAM_END && done<length) { return LIBZIPPP_ERROR_FREAD_FAILURE; } //entry shorter than expected
+        }
+        return (libzippp_int64)done;
+    }
+
+    static int readEntryChunks(zip* zipHandle, const ZipEntry& zipEntry, int flag, const std::function<bool(const void*,libzippp_uint64)>& writeFunc, libzippp_uint64 chunksize) {
+        int iRes = LIBZIPPP_OK;
+        struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), flag);
+        if (zipFile) {
+            libzippp_uint64 maxSize = zipEntry.getSize();
+            if (!chunksize) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; } // use the default chunk size (512K) if not specified by the user
+
+            if (maxSize<chunksize) {
+                char* data = NEW_CHAR_ARRAY(maxSize)
+                if (data!=nullptr) {
+                    libzippp_int64 result = zip_fread(zipFile, data, maxSize);
+                    if (result>=0) {
+                        if (result != static_cast<libzippp_int64>(maxSize)) {
+                            iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
+                        } else if (!writeFunc(data, maxSize)) {
+                            iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
+                        }
+                    } else {
+                        iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
+                    }
+                    delete[] data;
+                } else {
+                    iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+                }
+            } else {
+                libzippp_uint64 uWrittenBytes = 0;
+                libzippp_int64 result = 0;
+                char* data = NEW_CHAR_ARRAY(chunksize)
+                if (data!=nullptr) {
+                    string::size_type nbChunks = maxSize/chunksize;
+                    for (libzippp_uint64 uiChunk=0 ; uiChunk<nbChunks ; ++uiChunk) {
+                        result = zip_fread(zipFile, data, chunksize);
+                        if (result>=0) {
+                            if (result!=static_cast<libzippp_int64>(chunksize)) {
+                                iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
+                                break;
+                            } else {
+                                if (!writeFunc(data, chunksize)) {
+                                    iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
+                                    break;
+                                }
+                                uWrittenBytes += result;
+                            }
+                        } else {
+                            iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
+                            break;
+                        }
+                    }
+                    delete[] data;
+                } else {
+                    iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+                }
+
+                libzippp_uint64 leftOver = maxSize%chunksize;
+                if (iRes==0 && leftOver>0) {
+                    char* data = NEW_CHAR_ARRAY(leftOver);
+                    if (data!=nullptr) {
+                        result = zip_fread(zipFile, data, leftOver);
+                        if (result>=0) {
+                            if (result!=static_cast<libzippp_int64>(leftOver)) {
+                                iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
+                            } else {
+                                if (!writeFunc(data, leftOver)) {
+                                    iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
+                                } else {
+                                    uWrittenBytes += result;
+                                    if (uWrittenBytes!=maxSize) {
+                                        iRes = LIBZIPPP_ERROR_UNKNOWN; // shouldn't occur but let's be careful
+                                    }
+                                }
+                            }
+                        } else {
+                            iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
+                        }
+                    } else {
+                        iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+                    }
+                    delete[] data;
+                }
+            }
+            zip_fclose(zipFile);
+        } else {
+           iRes = LIBZIPPP_ERROR_FOPEN_FAILURE;
+        }
+        return iRes;
+    }
+
+    //same as readEntryChunks, but the next chunk is read by a worker thread while writeFunc processes the current one
+    static int readEntryChunksAsync(zip* zipHandle, const ZipEntry& zipEntry, int flag, const std::function<bool(const void*,libzippp_uint64)>& writeFunc, libzippp_uint64 chunksize) {
+        libzippp_uint64 maxSize = zipEntry.getSize();
+        if (!chunksize) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; }
+        if (maxSize<=chunksize) { return readEntryChunks(zipHandle, zipEntry, flag, writeFunc, chunksize); } //nothing to overlap
+
+        struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), flag);
+        if (zipFile==nullptr) { return LIBZIPPP_ERROR_FOPEN_FAILURE; }
+
+        char* data = NEW_CHAR_ARRAY(chunksize)
+        char* nextData = NEW_CHAR_ARRAY(chunksize)
+        std::unique_ptr<char[]> buffers[2];
+        buffers[0].reset(data);
+        buffers[1].reset(nextData);
+        if (!buffers[0] || !buffers[1]) {
+            zip_fclose(zipFile);
+            return LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+        }
+
+        libzippp_uint64 nbChunks = maxSize/chunksize+(maxSize%chunksize>0 ? 1 : 0);
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool filled[2] = { false, false };
+        libzippp_int64 results[2] = { 0, 0 };
+        bool stopped = false;
+
+        std::thread worker([&]() {
+            for(libzippp_uint64 chunk=0 ; chunk<nbChunks ; ++chunk) {
+                int slot = chunk%2;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() { return stopped || !filled[slot]; });
+                    if (stopped) { return; }
+                }
+
+                libzippp_uint64 length = chunk<nbChunks-1 ? chunksize : maxSize-chunk*chunksize;
+                libzippp_int64 result = zip_fread(zipFile, buffers[slot].get(), length);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                results[slot] = result;
+                filled[slot] = true;
+                condition.notify_all();
+                if (result!=static_cast<libzippp_int64>(length)) { return; } //the consumer reports the error
+            }
+        });
+
+        int iRes = LIBZIPPP_OK;
+        for(libzippp_uint64 chunk=0 ; chunk<nbChunks && iRes==LIBZIPPP_OK ; ++chunk) {
+            int slot = chunk%2;
+            libzippp_int64 result;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return filled[slot]; });
+                result = results[slot];
+            }
+
+            libzippp_uint64 length = chunk<nbChunks-1 ? chunksize : maxSize-chunk*chunksize;
+            if (result<0) { iRes = LIBZIPPP_ERROR_FREAD_FAILURE; }
+            else if (result!=static_cast<libzippp_int64>(length)) { iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE; }
+            else {
+                bool written;
+                try {
+                    written = writeFunc(buffers[slot].get(), length);
+                } catch (...) { //the worker must be stopped before the exception leaves the function
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopped = true;
+                        condition.notify_all();
+                    }
+                    worker.join();
+                    zip_fclose(zipFile);
+                    throw;
+                }
+                if (!written) { iRes = LIBZIPPP_ERROR_OWRITE_FAILURE; }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            filled[slot] = false;
+            if (iRes!=LIBZIPPP_OK) { stopped = true; }
+            condition.notify_all();
+        }
+
+        worker.join();
+        zip_fclose(zipFile);
+        return iRes;
+    }
+}
+
+static void defaultErrorHandler(const std::string& message,
+                                const std::string& strerror,
+                                int /*zip_error_code*/,
+                                int /*system_error_code*/)
+{
+    fprintf(stderr, message.c_str(), strerror.c_str());
+}
+
+namespace libzippp {
+    //an entry compressed by a ZipCompressionPool, from a buffer or a file
+    struct ZipCompressionJob {
+        enum State { Pending, Running, Done, Released };
+
+        ZipCompressionJob(const void* d, libzippp_uint64 l, bool f) : data(d), length(l), freeData(f), mode(0), state(Pending), submitted(false), cancelled(false), failed(false), size(0), crc(0) {}
+        ZipCompressionJob(const string& f, libzippp_uint32 m) : data(nullptr), length(0), freeData(false), file(f), mode(m), state(Pending), submitted(false), cancelled(false), failed(false), size(0), crc(0) {}
+        ~ZipCompressionJob(void) { if (freeData) { free(const_cast<void*>(data)); } }
+
+        const void* data;
+        libzippp_uint64 length;
+        bool freeData;
+        shared_ptr<void> owner; //keeps the data alive while compressed, even if the entry is replaced
+        string file;
+        libzippp_uint32 mode; //Unix mode of the file, zero if unknown
+
+        //guarded by the mutex of the pool, the output is released once written in the archive
+        State state;
+        bool submitted;
+        bool cancelled; //the entry has been replaced or deleted
+        bool failed;
+        libzippp_uint64 size;
+        libzippp_uint32 crc;
+        vector<char> compressed;
+
+        //raw deflate with the default level of libzip, computes the size and the CRC of the input
+        bool compress(void) {
+            compressed.clear();
+
+            ifstream input;
+            const char* next = static_cast<const char*>(data);
+            libzippp_uint64 remaining = length;
+            if (!file.empty()) {
+                input.open(file.c_str(), ios::in | ios::binary);
+                if (!input) { return false; }
+            }
+
+            return Helper::deflateData([&](void* buffer, libzippp_uint64 size) -> libzippp_int64 {
+                if (!file.empty()) {
+                    input.read(static_cast<char*>(buffer), size);
+                    return input.bad() ? -1 : (libzippp_int64)input.gcount();
+                }
+                libzippp_uint64 nread = remaining<size ? remaining : size;
+                memcpy(buffer, next, nread);
+                next += nread;
+                remaining -= nread;
+                return (libzippp_int64)nread;
+            }, [this](const void* buffer, libzippp_uint64 size) {
+                const char* bytes = static_cast<const char*>(buffer);
+                compressed.insert(compressed.end(), bytes, bytes+size);
+                return true;
+            }, false, &size, &crc);
+        }
+    };
+
+    //worker threads compressing the submitted jobs in order, while at most maxReady compressed jobs holding at most
+    //maxReadySize bytes are not released (zero means no limit)
+    class ZipCompressionPool {
+    public:
+        ZipCompressionPool(libzippp_uint32 nbThreads, libzippp_uint32 maxReady, libzippp_uint64 maxReadySize) : stopping(false), maxReady(maxReady), nbReady(0), maxReadySize(maxReadySize), readySize(0) {
+            for(libzippp_uint32 i=0 ; i<nbThreads ; ++i) {
+                workers.push_back(thread(&ZipCompressionPool::work, this));
+            }
+        }
+
+        ~ZipCompressionPool(void) {
+            {
+                lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                condition.notify_all();
+            }
+            for(vector<thread>::iterator it=workers.begin() ; it!=workers.end() ; ++it) {
+                it->join();
+            }
+        }
+
+        void submit(const shared_ptr<ZipCompressionJob>& job) {
+            lock_guard<std::mutex> lock(mutex);
+            if (job->submitted) { return; }
+            job->submitted = true;
+            queue.push_back(job);
+            condition.notify_all();
+        }
+
+        //compresses the job in the calling thread if no worker has started it yet (the writer never waits for the
+        //pool to make room), or waits for the worker and returns false if the compression failed
+        bool wait(const shared_ptr<ZipCompressionJob>& job) {
+            unique_lock<std::mutex> lock(mutex);
+            if (job->state==ZipCompressionJob::Released) { job->state = ZipCompressionJob::Pending; } //reopened source
+            if (job->state==ZipCompressionJob::Pending) {
+                run(job, lock);
+            } else {
+                condition.wait(lock, [&job]() { return job->state==ZipCompressionJob::Done; });
+            }
+            return !job->failed;
+        }
+
+        //frees the compressed data once written
+        void release(const shared_ptr<ZipCompressionJob>& job) {
+            lock_guard<std::mutex> lock(mutex);
+            if (job->state==ZipCompressionJob::Done) { drop(job); }
+        }
+
+        //skips the job if it has not been started yet, otherwise its compressed data is freed once available
+        void cancel(const shared_ptr<ZipCompressionJob>& job) {
+            lock_guard<std::mutex> lock(mutex);
+            job->cancelled = true;
+            if (job->state==ZipCompressionJob::Done) { drop(job); }
+        }
+
+        //amount of compressed data not released yet
+        libzippp_uint64 getReadySize(void) {
+            lock_guard<std::mutex> lock(mutex);
+            return readySize;
+        }
+
+    private:
+        std::mutex mutex;
+        condition_variable condition;
+        deque<shared_ptr<ZipCompressionJob> > queue;
+        vector<thread> workers;
+        bool stopping;
+        libzippp_uint32 maxReady;
+        libzippp_uint32 nbReady;
+        libzippp_uint64 maxReadySize;
+        libzippp_uint64 readySize;
+
+        void run(const shared_ptr<ZipCompressionJob>& job, unique_lock<std::mutex>& lock) {
+            job->state = ZipCompressionJob::Running;
+            lock.unlock();
+            bool success = job->compress();
+            lock.lock();
+            job->failed = !success;
+            job->state = ZipCompressionJob::Done;
+            ++nbReady;
+            readySize += job->compressed.size();
+            if (job->cancelled) { drop(job); } //cancelled while running
+            condition.notify_all();
+        }
+
+        //frees the compressed data of a job, the mutex being locked
+        void drop(const shared_ptr<ZipCompressionJob>& job) {
+            readySize -= job->compressed.size();
+            vector<char>().swap(job->compressed);
+            job->state = ZipCompressionJob::Released;
+            --nbReady;
+            condition.notify_all();
+        }
+
+        bool isFull(void) const {
+            return (maxReady>0 && nbReady>=maxReady) || (maxReadySize>0 && readySize>=maxReadySize);
+        }
+
+        void work(void) {
+            unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                //the cancelled jobs are removed from the queue even if the pool is full
+                condition.wait(lock, [this]() { return stopping || (!queue.empty() && (queue.front()->cancelled || !isFull())); });
+                if (stopping) { return; }
+
+                shared_ptr<ZipCompressionJob> job = queue.front();
+                queue.pop_front();
+                if (job->state==ZipCompressionJob::Pending && !job->cancelled) { run(job, lock); } //otherwise already taken by the writer
+            }
+        }
+
+        //prevent copy
+        ZipCompressionPool(const ZipCompressionPool&);
+        ZipCompressionPool& operator=(const ZipCompressionPool&);
+    };
+
+    //zip_source serving the compressed data of a job to libzip, which writes it as is
+    struct ZipCompressedSource {
+        ZipCompressedSource(ZipCompressionPool* p, const shared_ptr<ZipCompressionJob>& j) : pool(p), job(j), offset(0) { zip_error_init(&error); }
+        ~ZipCompressedSource(void) { zip_error_fini(&error); }
+
+        ZipCompressionPool* pool;
+        shared_ptr<ZipCompressionJob> job;
+        libzippp_uint64 offset;
+        zip_error_t error;
+
+        static zip_int64_t callback(void* userdata, void* data, zip_uint64_t len, zip_source_cmd_t cmd) {
+            ZipCompressedSource* source = static_cast<ZipCompressedSource*>(userdata);
+            switch (cmd) {
+                case ZIP_SOURCE_OPEN:
+                    if (!source->pool->wait(source->job)) {
+                        zip_error_set(&source->error, ZIP_ER_READ, 0);
+                        return -1;
+                    }
+                    source->offset = 0;
+                    return 0;
+                case ZIP_SOURCE_READ: {
+                    const vector<char>& compressed = source->job->compressed;
+                    libzippp_uint64 available = compressed.size()-source->offset;
+                    libzippp_uint64 n = len<available ? len : available;
+                    if (n>0) { memcpy(data, compressed.data()+source->offset, n); }
+                    source->offset += n;
+                    return (zip_int64_t)n;
+                }
+                case ZIP_SOURCE_CLOSE:
+                    source->pool->release(source->job);
+                    return 0;
+                case ZIP_SOURCE_STAT: {
+                    if (len<sizeof(zip_stat_t)) {
+                        zip_error_set(&source->error, ZIP_ER_INVAL, 0);
+                        return -1;
+                    }
+                    if (!source->pool->wait(source->job)) {
+                        zip_error_set(&source->error, ZIP_ER_READ, 0);
+                        return -1;
+                    }
+                    zip_stat_t* st = static_cast<zip_stat_t*>(data);
+                    zip_stat_init(st);
+                    st->size = source->job->size;
+                    st->comp_size = source->job->compressed.size();
+                    st->comp_method = ZIP_CM_DEFLATE;
+                    st->crc = source->job->crc;
+                    st->encryption_method = ZIP_EM_NONE;
+                    st->valid = ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE | ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC | ZIP_STAT_ENCRYPTION_METHOD;
+                    return sizeof(zip_stat_t);
+                }
+                case ZIP_SOURCE_GET_FILE_ATTRIBUTES: //the mode of the file replaced by this source
+                    if (!Helper::getFileAttributes(source->job->mode, data, len)) {
+                        zip_error_set(&source->error, ZIP_ER_INVAL, 0);
+                        return -1;
+                    }
+                    return sizeof(zip_file_attributes_t);
+                case ZIP_SOURCE_ERROR:
+                    return zip_error_to_data(&source->error, data, len);
+                case ZIP_SOURCE_FREE:
+                    source->pool->release(source->job);
+                    delete source;
+                    return 0;
+                case ZIP_SOURCE_SUPPORTS:
+                    return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT, ZIP_SOURCE_GET_FILE_ATTRIBUTES, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+                default:
+                    zip_error_set(&source->error, ZIP_ER_OPNOTSUPP, 0);
+                    return -1;
+            }
+        }
+    };
+
+    //source pulling the data of an entry from a generator while the archive is written, the size being unknown until then
+    struct ZipGeneratorSource {
+        explicit ZipGeneratorSource(const std::function<libzippp_int64(void*,libzippp_uint64)>& g) : generator(g), opened(false) { zip_error_init(&error); }
+        ~ZipGeneratorSource(void) { zip_error_fini(&error); }
+
+        std::function<libzippp_int64(void*,libzippp_uint64)> generator;
+        bool opened;
+        zip_error_t error;
+
+        static zip_int64_t callback(void* userdata, void* data, zip_uint64_t len, zip_source_cmd_t cmd) {
+            ZipGeneratorSource* source = static_cast<ZipGeneratorSource*>(userdata);
+            switch (cmd) {
+                case ZIP_SOURCE_OPEN:
+                    if (source->opened) { //the data can only be generated once
+                        zip_error_set(&source->error, ZIP_ER_READ, 0);
+                        return -1;
+                    }
+                    source->opened = true;
+                    return 0;
+                case ZIP_SOURCE_READ: {
+                    libzippp_int64 result = source->generator(data, len);
+                    if (result<0) {
+                        zip_error_set(&source->error, ZIP_ER_READ, 0);
+                        return -1;
+                    }
+                    return (zip_uint64_t)result<len ? result : (zip_int64_t)len;
+                }
+                case ZIP_SOURCE_CLOSE:
+                    return 0;
+                case ZIP_SOURCE_STAT: {
+                    if (len<sizeof(zip_stat_t)) {
+                        zip_error_set(&source->error, ZIP_ER_INVAL, 0);
+                        return -1;
+                    }
+                    zip_stat_init(static_cast<zip_stat_t*>(data));
+                    return sizeof(zip_stat_t);
+                }
+                case ZIP_SOURCE_ERROR:
+                    return zip_error_to_data(&source->error, data, len);
+                case ZIP_SOURCE_FREE:
+                    delete source;
+                    return 0;
+                case ZIP_SOURCE_SUPPORTS:
+                    return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+                default:
+                    zip_error_set(&source->error, ZIP_ER_OPNOTSUPP, 0);
+                    return -1;
+            }
+        }
+    };
+
+    //worker thread reading the files added by ZipArchive::addDirectory in the order in which libzip writes them, while
+    //at most maxBuffered bytes are read ahead; the larger files, or the ones not read yet, are read by their source
+    class ZipFilePrefetcher {
+    public:
+        explicit ZipFilePrefetcher(libzippp_uint64 maxBuffered) : maxBuffered(maxBuffered), buffered(0), released(0), reading(0), busy(false), started(false), stopping(false) {}
+
+        ~ZipFilePrefetcher(void) {
+            {
+                lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                condition.notify_all();
+            }
+            if (worker.joinable()) { worker.join(); }
+        }
+
+        //the files can't be added anymore once the first one has been taken, the ones not read ahead are read by
+        //their source (or by a compression job)
+        size_t add(const string& path, libzippp_uint64 size, bool readAhead) {
+            files.push_back(File(path, size));
+            files.back().taken = !readAhead;
+            return files.size()-1;
+        }
+
+        const string& getPath(size_t index) const { return files[index].path; }
+
+        //returns the content of the file if it has been read ahead (null otherwise), the previous files being skipped
+        shared_ptr<vector<char> > take(size_t index) {
+            unique_lock<std::mutex> lock(mutex);
+            if (!started) {
+                started = true;
+                worker = thread(&ZipFilePrefetcher::work, this);
+            }
+            condition.wait(lock, [this, index]() { return !busy || reading!=index; });
+
+            while (released<index) { drop(released++); }
+            shared_ptr<vector<char> > data;
+            if (!files[index].taken) {
+                data = files[index].data;
+                drop(index);
+            }
+            condition.notify_all();
+            return data;
+        }
+
+    private:
+        struct File {
+            File(const string& p, libzippp_uint64 s) : path(p), size(s), taken(false) {}
+
+            string path;
+            libzippp_uint64 size;
+            bool taken;
+            shared_ptr<vector<char> > data;
+        };
+
+        vector<File> files;
+        std::mutex mutex;
+        condition_variable condition;
+        thread worker;
+        libzippp_uint64 maxBuffered;
+        libzippp_uint64 buffered;
+        size_t released;
+        size_t reading;
+        bool busy;
+        bool started;
+        bool stopping;
+
+        void drop(size_t index) {
+            if (files[index].data) {
+                buffered -= files[index].data->size();
+                files[index].data.reset();
+            }
+            files[index].taken = true;
+        }
+
+        void work(void) {
+            unique_lock<std::mutex> lock(mutex);
+            for(size_t i=0 ; i<files.size() ; ++i) {
+                if (files[i].size>maxBuffered) { continue; }
+                condition.wait(lock, [this, i]() { return stopping || files[i].taken || buffered+files[i].size<=maxBuffered; });
+                if (stopping) { return; }
+                if (files[i].taken) { continue; }
+
+                string path = files[i].path;
+                libzippp_uint64 size = files[i].size;
+                reading = i;
+                busy = true;
+                lock.unlock();
+                shared_ptr<vector<char> > data = readFile(path, size);
+                lock.lock();
+                busy = false;
+                if (data && !files[i].taken) {
+                    files[i].data = data;
+                    buffered += data->size();
+                }
+                condition.notify_all();
+            }
+        }
+
+        //returns null if the file can't be read or if its size has changed (it is then read by the source)
+        static shared_ptr<vector<char> > readFile(const string& path, libzippp_uint64 size) {
+            FILE* input = fopen(path.c_str(), "rb");
+            if (input==nullptr) { return nullptr; }
+            shared_ptr<vector<char> > data = make_shared<vector<char> >((size_t)size);
+            size_t nread = size>0 ? fread(data->data(), 1, data->size(), input) : 0;
+            bool complete = nread==data->size() && fgetc(input)==EOF;
+            fclose(input);
+            return complete ? data : nullptr;
+        }
+
+        //prevent copy
+        ZipFilePrefetcher(const ZipFilePrefetcher&);
+        ZipFilePrefetcher& operator=(const ZipFilePrefetcher&);
+    };
+
+    //source of a file added by ZipArchive::addDirectory, whose size, time and mode are already known
+    struct ZipPrefetchedFileSource {
+        ZipPrefetchedFileSource(const shared_ptr<ZipFilePrefetcher>& p, size_t i, libzippp_uint64 s, time_t m, libzippp_uint32 fm) : prefetcher(p), index(i), size(s), mtime(m), mode(fm), input(nullptr), offset(0) { zip_error_init(&error); }
+        ~ZipPrefetchedFileSource(void) {
+            if (input!=nullptr) { fclose(input); }
+            zip_error_fini(&error);
+        }
+
+        shared_ptr<ZipFilePrefetcher> prefetcher;
+        size_t index;
+        libzippp_uint64 size;
+        time_t mtime;
+        libzippp_uint32 mode;
+        shared_ptr<vector<char> > data;
+        FILE* input;
+        libzippp_uint64 offset;
+        zip_error_t error;
+
+        static zip_int64_t callback(void* userdata, void* data, zip_uint64_t len, zip_source_cmd_t cmd) {
+            ZipPrefetchedFileSource* source = static_cast<ZipPrefetchedFileSource*>(userdata);
+            switch (cmd) {
+                case ZIP_SOURCE_OPEN:
+                    source->data = source->prefetcher->take(source->index);
+                    source->offset = 0;
+                    if (!source->data) { //not read ahead
+                        source->input = fopen(source->prefetcher->getPath(source->index).c_str(), "rb");
+                        if (source->input==nullptr) {
+                            zip_error_set(&source->error, ZIP_ER_OPEN, errno);
+                            return -1;
+                        }
+                    }
+                    return 0;
+                case ZIP_SOURCE_READ: {
+                    if (source->data) {
+                        libzippp_uint64 available = source->data->size()-source->offset;
+                        libzippp_uint64 n = len<available ? len : available;
+                        if (n>0) { memcpy(data, source->data->data()+source->offset, n); }
+                        source->offset += n;
+                        return (zip_int64_t)n;
+                    }
+                    size_t n = fread(data, 1, (size_t)len, source->input);
+                    if (ferror(source->input)) {
+                        zip_error_set(&source->error, ZIP_ER_READ, errno);
+                        return -1;
+                    }
+                    return (zip_int64_t)n;
+                }
+                case ZIP_SOURCE_CLOSE:
+                    source->data.reset();
+                    if (source->input!=nullptr) {
+                        fclose(source->input);
+                        source->input = nullptr;
+                    }
+                    return 0;
+                case ZIP_SOURCE_STAT: {
+                    if (len<sizeof(zip_stat_t)) {
+                        zip_error_set(&source->error, ZIP_ER_INVAL, 0);
+                        return -1;
+                    }
+                    zip_stat_t* st = static_cast<zip_stat_t*>(data);
+                    zip_stat_init(st);
+                    st->size = source->size;
+                    st->mtime = source->mtime;
+                    st->valid = ZIP_STAT_SIZE | ZIP_STAT_MTIME;
+                    return sizeof(zip_stat_t);
+                }
+                case ZIP_SOURCE_GET_FILE_ATTRIBUTES:
+                    if (!Helper::getFileAttributes(source->mode, data, len)) {
+                        zip_error_set(&source->error, ZIP_ER_INVAL, 0);
+                        return -1;
+                    }
+                    return sizeof(zip_file_attributes_t);
+                case ZIP_SOURCE_ERROR:
+                    return zip_error_to_data(&source->error, data, len);
+                case ZIP_SOURCE_FREE:
+                    delete source;
+                    return 0;
+                case ZIP_SOURCE_SUPPORTS:
+                    return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT, ZIP_SOURCE_GET_FILE_ATTRIBUTES, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+                default:
+                    zip_error_set(&source->error, ZIP_ER_OPNOTSUPP, 0);
+                    return -1;
+            }
+        }
+    };
+}
+
+namespace libzippp {
+    //one-shot inflate with zlib, in slices of at most LIBZIPPP_ZLIB_MAX_LENGTH bytes
+    class ZipZlibInflateBackend : public ZipInflateBackend {
+    public:
+        bool inflate(const void* input, libzippp_uint64 inputLength, void* output, libzippp_uint64 outputLength) const {
+            z_stream stream;
+            memset(&stream, 0, sizeof(stream));
+            if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) { return false; }
+
+            stream.next_in = static_cast<Bytef*>(const_cast<void*>(input));
+            stream.next_out = static_cast<Bytef*>(output);
+            libzippp_uint64 remainingInput = inputLength;
+            libzippp_uint64 remainingOutput = outputLength;
+            int result = Z_OK;
+            while (result==Z_OK) {
+                if (stream.avail_in==0) {
+                    stream.avail_in = (uInt)(remainingInput<LIBZIPPP_ZLIB_MAX_LENGTH ? remainingInput : LIBZIPPP_ZLIB_MAX_LENGTH);
+                    remainingInput -= stream.avail_in;
+                }
+                if (stream.avail_out==0) {
+                    stream.avail_out = (uInt)(remainingOutput<LIBZIPPP_ZLIB_MAX_LENGTH ? remainingOutput : LIBZIPPP_ZLIB_MAX_LENGTH);
+                    remainingOutput -= stream.avail_out;
+                }
+                result = ::inflate(&stream, Z_NO_FLUSH); //Z_BUF_ERROR once no progress is possible
+            }
+            bool complete = result==Z_STREAM_END && stream.avail_out==0 && remainingOutput==0;
+            inflateEnd(&stream);
+            return complete;
+        }
+    };
+
+#ifdef LIBZIPPP_WITH_LIBDEFLATE
+    class ZipLibdeflateInflateBackend : public ZipInflateBackend {
+    public:
+        //a decompressor can't be shared between threads, its allocation is cheap compared to a whole entry
+        bool inflate(const void* input, libzippp_uint64 inputLength, void* output, libzippp_uint64 outputLength) const {
+            struct libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+            if (decompressor==nullptr) { return false; }
+            enum libdeflate_result result = libdeflate_deflate_decompress(decompressor, input, (size_t)inputLength, output, (size_t)outputLength, nullptr);
+            libdeflate_free_decompressor(decompressor);
+            return result==LIBDEFLATE_SUCCESS; //fails if the output isn't filled exactly
+        }
+
+        libzippp_uint32 crc32(const void* data, libzippp_uint64 length) const {
+            return libdeflate_crc32(0, data, (size_t)length);
+        }
+    };
+#endif
+}
+
+libzippp_uint32 ZipInflateBackend::crc32(const void* data, libzippp_uint64 length) const {
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    const Bytef* next = static_cast<const Bytef*>(data);
+    while (length>0) {
+        uInt chunk = (uInt)(length<LIBZIPPP_ZLIB_MAX_LENGTH ? length : LIBZIPPP_ZLIB_MAX_LENGTH);
+        crc = ::crc32(crc, next, chunk);
+        next += chunk;
+        length -= chunk;
+    }
+    return (libzippp_uint32)crc;
+}
+
+ZipInflateBackend* ZipInflateBackend::zlib(void) {
+    static ZipZlibInflateBackend backend;
+    return &backend;
+}
+
+ZipInflateBackend* ZipInflateBackend::libdeflate(void) {
+#ifdef LIBZIPPP_WITH_LIBDEFLATE
+    static ZipLibdeflateInflateBackend backend;
+    return &backend;
+#else
+    return nullptr;
+#endif
+}
+
+ZipEntry::ZipEntry(void) : zipFile(nullptr), index(0), time(0), compressionMethod(ZIP_CM_DEFAULT), compressionLevel(0), encryptionMethod(ZIP_EM_NONE), size(0), sizeComp(0), crc(0) {
+}
+
+string ZipEntry::getComment(void) const {
+    return zipFile->getEntryComment(*this);
+}
+
+bool ZipEntry::setComment(const string& str) const {
+    return zipFile->setEntryComment(*this, str);
+}
+
+bool ZipEntry::setCompressionMethod(CompressionMethod compMethod) {
+    return zipFile->setEntryCompressionConfig(*this, compMethod, compressionLevel);
+}
+
+CompressionMethod ZipEntry::getCompressionMethod(void) const {
+    return convertCompressionFromLibzip(compressionMethod);
+}
+
+bool ZipEntry::setCompressionLevel(libzippp_uint32 level) {
+    return zipFile->setEntryCompressionConfig(*this, convertCompressionFromLibzip(compressionMethod), level);
+}
+
+string ZipEntry::readAsText(ZipArchive::State state, libzippp_uint64 size) const {
+    string str;
+    if (zipFile==nullptr) { return str; }
+    Helper::readEntryInto(*zipFile, *this, str, state, size); //cleared if the ZipArchive has been closed
+    return str;
+}
+
+libzippp_uint8* ZipEntry::readAsBinary(ZipArchive::State state, libzippp_uint64 size) const {
+    return (libzippp_uint8*)zipFile->readEntry(*this, false, state, size);
+}
+
+basic_string<libzippp_uint8> ZipEntry::readAsBinaryString(ZipArchive::State state, libzippp_uint64 size) const {
+    basic_string<libzippp_uint8> str;
+    if (zipFile==nullptr) { return str; }
+    Helper::readEntryInto(*zipFile, *this, str, state, size); //cleared if the ZipArchive has been closed
+    return str;
+}
+
+int ZipEntry::readContent(std::ostream& ofOutput, ZipArchive::State state, libzippp_uint64 chunksize) const {
+   return zipFile->readEntry(*this, ofOutput, state, chunksize);
+}
+
+std::istream* ZipEntry::openStream(ZipArchive::State state, libzippp_uint64 chunksize) const {
+    if (zipFile==nullptr || !zipFile->isOpen()) { return nullptr; }
+
+    ZipEntryStream* stream = new (std::nothrow) ZipEntryStream(*this, state, chunksize);
+    if (stream!=nullptr && !stream->isOpen()) { //unable to open the entry
+        delete stream;
+        return nullptr;
+    }
+    return stream;
+}
+
+ZipEntryIterator::ZipEntryIterator(const ZipArchive* zipFile, libzippp_int64 index, libzippp_int64 end, ZipArchive::State state) :
+        zipFile(zipFile), index(index), end(end), state(state) {
+    load();
+}
+
+void ZipEntryIterator::load(void) {
+    while (index<end) {
+        entry = zipFile->getEntry(index, state);
+        if (!entry.isNull()) { return; }
+        ++index; //deleted entry
+    }
+    entry = ZipEntry();
+}
+
+ZipEntryIterator& ZipEntryIterator::operator++(void) {
+    if (index<end) {
+        ++index;
+        load();
+    }
+    return *this;
+}
+
+ZipEntryIterator ZipEntryIterator::operator++(int) {
+    ZipEntryIterator it(*this);
+    ++(*this);
+    return it;
+}
+
+ZipEntryReader::ZipEntryReader(const ZipEntry& entry, ZipArchive::State state, libzippp_uint64 checkpointInterval) :
+        entry(entry), state(state), checkpointInterval(checkpointInterval), checkpointsBuilt(false) {
+}
+
+libzippp_int64 ZipEntryReader::readRange(libzippp_uint64 offset, void* buffer, libzippp_uint64 length) {
+    if (entry.isNull()) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    if (!entry.zipFile->isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+    if (buffer==nullptr) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+
+    libzippp_uint64 size = entry.getSize();
+    if (offset>=size) { return 0; }
+    if (length>size-offset) { length = size-offset; }
+    if (length==0) { return 0; }
+
+    zip* zipHandle = entry.zipFile->getZipHandle();
+    int flag = state==ZipArchive::Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+
+    //the compressed data is the one of the original archive, whatever compression is set for the Current state
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    bool raw = zip_stat_index(zipHandle, entry.getIndex(), flag | ZIP_FL_UNCHANGED, &stat)==0 && stat.encryption_method==ZIP_EM_NONE;
+
+    struct zip_file* zipFile = nullptr;
+    if (raw && stat.comp_method==ZIP_CM_STORE) {
+        //the raw data is a window over the archive, without any CRC check preventing to seek
+        zipFile = zip_fopen_index(zipHandle, entry.getIndex(), flag | ZIP_FL_COMPRESSED);
+    } else if (raw && stat.comp_method==ZIP_CM_DEFLATE && checkpointInterval>0) {
+        if (!checkpointsBuilt) { buildCheckpoints(); }
+        if (!checkpoints.empty()) {
+            std::vector<Checkpoint>::const_iterator it = std::upper_bound(checkpoints.begin(), checkpoints.end(), offset,
+                    [](libzippp_uint64 value, const Checkpoint& checkpoint) { return value<checkpoint.uncompressedOffset; });
+            --it; //the first checkpoint is at the beginning of the entry
+            return readFromCheckpoint(*it, offset, buffer, length);
+        }
+    }
+
+    if (zipFile==nullptr) { zipFile = zip_fopen_index(zipHandle, entry.getIndex(), flag); }
+    if (zipFile==nullptr) { return LIBZIPPP_ERROR_FOPEN_FAILURE; }
+
+    libzippp_int64 result = Helper::readFileRange(zipFile, offset, buffer, length);
+    zip_fclose(zipFile);
+    return result;
+}
+
+void ZipEntryReader::buildCheckpoints(void) {
+    checkpointsBuilt = true;
+    checkpoints.clear();
+
+    zip* zipHandle = entry.zipFile->getZipHandle();
+    int flag = state==ZipArchive::Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+    struct zip_file* zipFile = zip_fopen_index(zipHandle, entry.getIndex(), flag | ZIP_FL_COMPRESSED);
+    if (zipFile==nullptr) { return; } //modified entry
+    if (zip_file_is_seekable(zipFile)!=1) { //the checkpoints couldn't be reached
+        zip_fclose(zipFile);
+        return;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) {
+        zip_fclose(zipFile);
+        return;
+    }
+
+    std::vector<libzippp_uint8> input(LIBZIPPP_INFLATE_INPUT_SIZE);
+    std::vector<libzippp_uint8> window(LIBZIPPP_INFLATE_WINDOW_SIZE);
+    std::vector<libzippp_uint8> ordered(LIBZIPPP_INFLATE_WINDOW_SIZE);
+
+    Checkpoint start;
+    start.uncompressedOffset = 0;
+    start.compressedOffset = 0;
+    start.bits = 0;
+    checkpoints.push_back(start);
+
+    libzippp_uint64 totalIn = 0;
+    libzippp_uint64 totalOut = 0;
+    bool success = false;
+    while (true) {
+        if (stream.avail_in==0) { //at the end of the data, inflate fails if it can't make any progress
+            libzippp_int64 nread = zip_fread(zipFile, input.data(), input.size());
+            if (nread<0) { break; }
+            stream.avail_in = (uInt)nread;
+            stream.next_in = input.data();
+        }
+        if (stream.avail_out==0) { //the window is used as a circular buffer
+            stream.avail_out = (uInt)window.size();
+            stream.next_out = window.data();
+        }
+
+        //stops at the end of each deflate block
+        totalIn += stream.avail_in;
+        totalOut += stream.avail_out;
+        int result = inflate(&stream, Z_BLOCK);
+        totalIn -= stream.avail_in;
+        totalOut -= stream.avail_out;
+
+        if (result==Z_STREAM_END) { success = true; break; }
+        if (result!=Z_OK) { break; }
+
+        bool blockEnd = (stream.data_type & 128) && !(stream.data_type & 64);
+        if (blockEnd && totalOut-checkpoints.back().uncompressedOffset>=checkpointInterval) {
+            libzippp_uint64 left = stream.avail_out;
+            memcpy(ordered.data(), window.data()+window.size()-left, left);
+            memcpy(ordered.data()+left, window.data(), window.size()-left);
+            libzippp_uint64 windowSize = totalOut<ordered.size() ? totalOut : ordered.size();
+
+            Checkpoint checkpoint;
+            checkpoint.uncompressedOffset = totalOut;
+            checkpoint.compressedOffset = totalIn;
+            checkpoint.bits = stream.data_type & 7;
+            checkpoint.window.assign(ordered.end()-windowSize, ordered.end());
+            checkpoints.push_back(checkpoint);
+        }
+    }
+
+    inflateEnd(&stream);
+    zip_fclose(zipFile);
+    if (!success || totalOut!=entry.getSize()) { checkpoints.clear(); }
+}
+
+libzippp_int64 ZipEntryReader::readFromCheckpoint(const Checkpoint& checkpoint, libzippp_uint64 offset, void* buffer, libzippp_uint64 length) const {
+    zip* zipHandle = entry.zipFile->getZipHandle();
+    int flag = state==ZipArchive::Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+    struct zip_file* zipFile = zip_fopen_index(zipHandle, entry.getIndex(), flag | ZIP_FL_COMPRESSED);
+    if (zipFile==nullptr) { return LIBZIPPP_ERROR_FOPEN_FAILURE; }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) {
+        zip_fclose(zipFile);
+        return LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+    }
+
+    libzippp_int64 result = LIBZIPPP_ERROR_FREAD_FAILURE;
+    libzippp_uint64 start = checkpoint.compressedOffset-(checkpoint.bits ? 1 : 0);
+    if (zip_fseek(zipFile, (zip_int64_t)start, SEEK_SET)==0) {
+        bool ready = true;
+        if (checkpoint.bits) { //the block starts within the previous byte
+            libzippp_uint8 byte = 0;
+            ready = zip_fread(zipFile, &byte, 1)==1 && inflatePrime(&stream, checkpoint.bits, byte >> (8-checkpoint.bits))==Z_OK;
+        }
+        if (ready && !checkpoint.window.empty()) {
+            ready = inflateSetDictionary(&stream, checkpoint.window.data(), (uInt)checkpoint.window.size())==Z_OK;
+        }
+        if (ready) {
+            result = Helper::inflateRange(zipFile, &stream, offset-checkpoint.uncompressedOffset, buffer, length);
+        }
+    }
+
+    inflateEnd(&stream);
+    zip_fclose(zipFile);
+    return result;
+}
+
+ZipEntryStreamBuf::ZipEntryStreamBuf(const ZipEntry& entry, ZipArchive::State state, libzippp_uint64 chunksize) :
+        zipHandle(nullptr), zipFile(nullptr), index(entry.getIndex()), flag(state==ZipArchive::Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS),
+        size(entry.getSize()), position(0) {
+    if (entry.isNull() || !entry.zipFile->isOpen()) { return; }
+
+    //no need of a buffer bigger than the entry
+    if (!chunksize) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; }
+    if (chunksize>size) { chunksize = size>0 ? size : 1; }
+    buffer.resize(chunksize);
+    setg(buffer.data(), buffer.data(), buffer.data());
+
+    zipHandle = entry.zipFile->getZipHandle();
+    zipFile = zip_fopen_index(zipHandle, index, flag);
+}
+
+ZipEntryStreamBuf::~ZipEntryStreamBuf(void) {
+    if (zipFile!=nullptr) { zip_fclose(zipFile); }
+}
+
+ZipEntryStreamBuf::int_type ZipEntryStreamBuf::underflow(void) {
+    if (gptr()<egptr()) { return traits_type::to_int_type(*gptr()); }
+    if (zipFile==nullptr) { return traits_type::eof(); }
+
+    libzippp_int64 result = zip_fread(zipFile, buffer.data(), buffer.size());
+    if (result<=0) { return traits_type::eof(); }
+
+    position += result;
+    setg(buffer.data(), buffer.data(), buffer.data()+result);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize ZipEntryStreamBuf::xsgetn(char* s, std::streamsize n) {
+    std::streamsize done = 0;
+    while (done<n) {
+        std::streamsize available = egptr()-gptr();
+        if (available>0) {
+            std::streamsize toCopy = n-done<available ? n-done : available;
+            memcpy(s+done, gptr(), toCopy);
+            gbump((int)toCopy);
+            done += toCopy;
+        } else if (zipFile!=nullptr && (libzippp_uint64)(n-done)>=buffer.size()) {
+            //big reads go straight to the destination
+            libzippp_int64 result = zip_fread(zipFile, s+done, n-done);
+            if (result<=0) { break; }
+            position += result;
+            done += result;
+        } else if (underflow()==traits_type::eof()) {
+            break;
+        }
+    }
+    return done;
+}
+
+std::streamsize ZipEntryStreamBuf::showmanyc(void) {
+    if (zipFile==nullptr) { return -1; }
+    return (std::streamsize)(size-position)+(egptr()-gptr());
+}
+
+ZipEntryStreamBuf::pos_type ZipEntryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    libzippp_int64 current = (libzippp_int64)position-(egptr()-gptr());
+    libzippp_int64 target = off;
+    if (dir==std::ios_base::cur) { target += current; }
+    else if (dir==std::ios_base::end) { target += size; }
+    return seekpos(pos_type(target), which);
+}
+
+ZipEntryStreamBuf::pos_type ZipEntryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    libzippp_int64 target = (off_type)pos;
+    if (!(which & std::ios_base::in) || zipFile==nullptr) { return pos_type(off_type(-1)); }
+    if (target<0 || target>(libzippp_int64)size) { return pos_type(off_type(-1)); }
+
+    //still within the current chunk
+    libzippp_int64 chunkStart = (libzippp_int64)position-(egptr()-eback());
+    if (target>=chunkStart && target<=(libzippp_int64)position) {
+        setg(eback(), eback()+(target-chunkStart), egptr());
+        return pos;
+    }
+
+    setg(buffer.data(), buffer.data(), buffer.data());
+    if (zip_file_is_seekable(zipFile)==1 && zip_fseek(zipFile, target, SEEK_SET)==0) {
+        position = target;
+        return pos;
+    }
+
+    if (target<(libzippp_int64)position) { //starts again from the beginning
+        zip_fclose(zipFile);
+        position = 0;
+        zipFile = zip_fopen_index(zipHandle, index, flag);
+        if (zipFile==nullptr) { return pos_type(off_type(-1)); }
+    }
+
+    while ((libzippp_int64)position<target) {
+        libzippp_uint64 toSkip = target-position<buffer.size() ? target-position : buffer.size();
+        libzippp_int64 result = zip_fread(zipFile, buffer.data(), toSkip);
+        if (result<=0) { return pos_type(off_type(-1)); }
+        position += result;
+    }
+    return pos;
+}
+
+ZipEntryStream::ZipEntryStream(const ZipEntry& entry, ZipArchive::State state, libzippp_uint64 chunksize) :
+        std::istream(nullptr), streamBuf(entry, state, chunksize) {
+    rdbuf(&streamBuf);
+    if (!streamBuf.isOpen()) { setstate(std::ios_base::failbit); }
+}
+
+ZipStreamWriter::ZipStreamWriter(ostream& output) :
+        writeFunc([&output](const void* data, libzippp_uint64 length) { return !output.write(static_cast<const char*>(data), length).fail(); }),
+        compressionMethod(ZIP_CM_DEFLATE), compressionLevel(0), stream(nullptr), offset(0), nbEntries(0), finished(false), failed(false),
+        entryOpen(false), entryMethod(ZIP_CM_STORE), entryZip64(false), entryMode(0), entryTime(0), entryOffset(0), entrySize(0), entryCompSize(0), entryCrc(0) {
+}
+
+ZipStreamWriter::ZipStreamWriter(const std::function<bool(const void*,libzippp_uint64)>& writeFunc) :
+        writeFunc(writeFunc),
+        compressionMethod(ZIP_CM_DEFLATE), compressionLevel(0), stream(nullptr), offset(0), nbEntries(0), finished(false), failed(false),
+        entryOpen(false), entryMethod(ZIP_CM_STORE), entryZip64(false), entryMode(0), entryTime(0), entryOffset(0), entrySize(0), entryCompSize(0), entryCrc(0) {
+}
+
+ZipStreamWriter::~ZipStreamWriter(void) {
+    finish();
+    if (stream!=nullptr) {
+        deflateEnd(stream);
+        delete stream;
+    }
+}
+
+bool ZipStreamWriter::setCompressionMethod(CompressionMethod comp) {
+    libzippp_uint16 method = convertCompressionToLibzip(comp);
+    if (method==(libzippp_uint16)ZIP_CM_DEFAULT) { method = ZIP_CM_DEFLATE; }
+    if (method!=ZIP_CM_STORE && method!=ZIP_CM_DEFLATE) { return false; }
+    compressionMethod = method;
+    return true;
+}
+
+CompressionMethod ZipStreamWriter::getCompressionMethod(void) const {
+    return convertCompressionFromLibzip(compressionMethod);
+}
+
+bool ZipStreamWriter::write(const void* data, libzippp_uint64 length) {
+    if (failed) { return false; }
+    if (length>0 && !writeFunc(data, length)) {
+        failed = true; //the archive can't be completed anymore
+        return false;
+    }
+    offset += length;
+    return true;
+}
+
+bool ZipStreamWriter::addEntry(const string& name) {
+    if (!LIBZIPPP_ENTRY_IS_DIRECTORY(name)) { return false; }
+    return addParentDirectories(name+"x");
+}
+
+bool ZipStreamWriter::addParentDirectories(const string& name) {
+    string::size_type nextSlash = name.find(LIBZIPPP_ENTRY_PATH_SEPARATOR);
+    while (nextSlash!=string::npos) {
+        string pathToCreate = name.substr(0, nextSlash+1);
+        if (directories.find(pathToCreate)==directories.end()) {
+            if (!startEntry(pathToCreate, ZIP_CM_STORE, false) || !closeEntry()) { return false; }
+            directories.insert(pathToCreate);
+        }
+        nextSlash = name.find(LIBZIPPP_ENTRY_PATH_SEPARATOR, nextSlash+1);
+    }
+    return true;
+}
+
+bool ZipStreamWriter::addData(const string& name, const void* data, libzippp_uint64 length) {
+    return openEntry(name, (libzippp_int64)length) && writeEntryData(data, length) && closeEntry();
+}
+
+bool ZipStreamWriter::addFile(const string& name, const string& file) {
+    ifstream input(file.c_str(), ios::in | ios::binary);
+    if (!input) { return false; }
+    libzippp_uint64 size = 0;
+    libzippp_uint32 mode = 0;
+    if (!openEntry(name, Helper::statFile(file, &size, &mode) ? (libzippp_int64)size : -1)) { return false; }
+    entryMode = mode; //saved in the central directory
+
+    vector<char> chunk(LIBZIPPP_DEFAULT_CHUNK_SIZE);
+    while (input) {
+        input.read(chunk.data(), chunk.size());
+        if (input.bad()) { break; }
+        if (!writeEntryData(chunk.data(), input.gcount())) { return false; }
+    }
+    if (input.bad()) {
+        failed = true; //the entry can't be completed
+        return false;
+    }
+    return closeEntry();
+}
+
+bool ZipStreamWriter::openEntry(const string& name, libzippp_int64 size) {
+    if (name.empty() || LIBZIPPP_ENTRY_IS_DIRECTORY(name)) { return false; }
+    if (finished || entryOpen) { return false; }
+    bool zip64 = size<0 || (libzippp_uint64)size>=LIBZIPPP_ZIP64_THRESHOLD;
+    return addParentDirectories(name) && startEntry(name, compressionMethod, zip64);
+}
+
+bool ZipStreamWriter::startEntry(const string& name, libzippp_uint16 method, bool zip64) {
+    if (finished || failed || entryOpen) { return false; }
+    if (name.size()>0xFFFF) { return false; }
+
+    if (method==ZIP_CM_DEFLATE) {
+        int level = compressionLevel>=1 && compressionLevel<=9 ? (int)compressionLevel : Z_BEST_COMPRESSION;
+        if (stream==nullptr) {
+            stream = new z_stream();
+            if (deflateInit2(stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)!=Z_OK) {
+                delete stream;
+                stream = nullptr;
+                return false;
+            }
+        } else if (deflateReset(stream)!=Z_OK || deflateParams(stream, level, Z_DEFAULT_STRATEGY)!=Z_OK) {
+            return false;
+        }
+        buffer.resize(LIBZIPPP_INFLATE_INPUT_SIZE*4);
+    }
+
+    entryName = name;
+    entryMethod = method;
+    entryZip64 = zip64;
+    entryMode = 0;
+    entryTime = time(nullptr);
+    entryOffset = offset;
+    entrySize = 0;
+    entryCompSize = 0;
+    entryCrc = crc32(0L, Z_NULL, 0);
+
+    //bit 3: the CRC and sizes are in the data descriptor
+    libzippp_uint16 flags = 0x0008 | (Helper::isUtf8Name(name) ? 0x0800 : 0);
+    vector<libzippp_uint8> header;
+    Helper::writeLocalHeader(header, name, zip64, flags, method, entryTime);
+    if (!write(header.data(), header.size())) { return false; }
+    entryOpen = true;
+    return true;
+}
+
+bool ZipStreamWriter::deflateEntryData(const void* data, libzippp_uint64 length, bool finish) {
+    const Bytef* next = static_cast<const Bytef*>(data);
+    int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+    int result = Z_OK;
+    do {
+        uInt input = length<LIBZIPPP_DEFAULT_CHUNK_SIZE ? (uInt)length : LIBZIPPP_DEFAULT_CHUNK_SIZE;
+        stream->next_in = const_cast<Bytef*>(next);
+        stream->avail_in = input;
+        do {
+            stream->next_out = buffer.data();
+            stream->avail_out = (uInt)buffer.size();
+            result = deflate(stream, flush);
+            if (result==Z_STREAM_ERROR) { return false; }
+            libzippp_uint64 produced = buffer.size()-stream->avail_out;
+            if (!write(buffer.data(), produced)) { return false; }
+            entryCompSize += produced;
+        } while (stream->avail_out==0 || (finish && result!=Z_STREAM_END));
+        next += input;
+        length -= input;
+    } while (length>0);
+    return true;
+}
+
+bool ZipStreamWriter::writeEntryData(const void* data, libzippp_uint64 length) {
+    if (!entryOpen || failed) { return false; }
+    if (length==0) { return true; }
+
+    //crc32 works with chunks of at most 4GB
+    const Bytef* bytes = static_cast<const Bytef*>(data);
+    for(libzippp_uint64 done=0 ; done<length ; done+=LIBZIPPP_DEFAULT_CHUNK_SIZE) {
+        libzippp_uint64 chunk = length-done<LIBZIPPP_DEFAULT_CHUNK_SIZE ? length-done : LIBZIPPP_DEFAULT_CHUNK_SIZE;
+        entryCrc = crc32(entryCrc, bytes+done, (uInt)chunk);
+    }
+    entrySize += length;
+
+    if (entryMethod==ZIP_CM_STORE) {
+        entryCompSize += length;
+        return write(data, length);
+    }
+    return deflateEntryData(data, length, false);
+}
+
+bool ZipStreamWriter::closeEntry(void) {
+    if (!entryOpen) { return false; }
+    entryOpen = false;
+    if (entryMethod==ZIP_CM_DEFLATE && !deflateEntryData(nullptr, 0, true)) { return false; }
+
+    //the sizes are written with 8 bytes when the local header has a Zip64 extra field, which is required to overflow
+    if (!entryZip64 && (entrySize>=0xFFFFFFFF || entryCompSize>=0xFFFFFFFF)) {
+        failed = true; //larger than the size given to openEntry
+        return false;
+    }
+    vector<libzippp_uint8> descriptor;
+    Helper::writeUInt32(descriptor, LIBZIPPP_DATA_DESCRIPTOR_SIGNATURE);
+    Helper::writeUInt32(descriptor, entryCrc);
+    if (entryZip64) {
+        Helper::writeUInt64(descriptor, entryCompSize);
+        Helper::writeUInt64(descriptor, entrySize);
+    } else {
+        Helper::writeUInt32(descriptor, (libzippp_uint32)entryCompSize);
+        Helper::writeUInt32(descriptor, (libzippp_uint32)entrySize);
+    }
+    if (!write(descriptor.data(), descriptor.size())) { return false; }
+
+    bool isDirectory = LIBZIPPP_ENTRY_IS_DIRECTORY(entryName);
+    libzippp_uint32 attributes = isDirectory ? (LIBZIPPP_DEFAULT_DIRECTORY_ATTRIBUTES<<16) | 0x10 : LIBZIPPP_DEFAULT_FILE_ATTRIBUTES<<16;
+    if (entryMode!=0) { attributes = Helper::fileAttributes(entryMode); }
+    libzippp_uint16 flags = 0x0008 | (Helper::isUtf8Name(entryName) ? 0x0800 : 0);
+    Helper::writeCentralRecord(centralDirectory, entryName, LIBZIPPP_OPSYS_UNIX, entryZip64, flags, entryMethod, entryTime, entryCrc, entryCompSize, entrySize, attributes, entryOffset);
+    ++nbEntries;
+    return true;
+}
+
+int ZipStreamWriter::finish(void) {
+    if (finished) { return failed ? LIBZIPPP_ERROR_OWRITE_FAILURE : LIBZIPPP_OK; }
+    if (entryOpen) { closeEntry(); }
+    finished = true;
+
+    libzippp_uint64 cdOffset = offset;
+    vector<libzippp_uint8> end;
+    Helper::writeEndRecords(end, nbEntries, cdOffset, centralDirectory.size(), comment.c_str(), (libzippp_uint16)(comment.size()<0xFFFF ? comment.size() : 0xFFFF));
+    bool success = write(centralDirectory.data(), centralDirectory.size()) && write(end.data(), end.size());
+    vector<libzippp_uint8>().swap(centralDirectory);
+    return success ? LIBZIPPP_OK : LIBZIPPP_ERROR_OWRITE_FAILURE;
+}
+
+ZipStreamReader::ZipStreamReader(istream& in) :
+        readFunc([&in](void* data, libzippp_uint64 length) -> libzippp_int64 {
+            in.read(static_cast<char*>(data), length);
+            return in.bad() ? -1 : (libzippp_int64)in.gcount();
+        }),
+        input(LIBZIPPP_INFLATE_INPUT_SIZE*4), inputStart(0), inputEnd(0), consumed(0), stream(nullptr), nbEntries(0), ended(false), failed(false),
+        entryOpen(false), entryDone(false), entryFlags(0), entryMethod(ZIP_CM_STORE), entryTime(0), entryZip64(false),
+        entrySize(0), entryCompSize(0), entryCrc(0), readSize(0), readCompSize(0), readCrc(0) {
+}
+
+ZipStreamReader::ZipStreamReader(const std::function<libzippp_int64(void*,libzippp_uint64)>& readFunc) :
+        readFunc(readFunc),
+        input(LIBZIPPP_INFLATE_INPUT_SIZE*4), inputStart(0), inputEnd(0), consumed(0), stream(nullptr), nbEntries(0), ended(false), failed(false),
+        entryOpen(false), entryDone(false), entryFlags(0), entryMethod(ZIP_CM_STORE), entryTime(0), entryZip64(false),
+        entrySize(0), entryCompSize(0), entryCrc(0), readSize(0), readCompSize(0), readCrc(0) {
+}
+
+ZipStreamReader::~ZipStreamReader(void) {
+    if (stream!=nullptr) {
+        inflateEnd(stream);
+        delete stream;
+    }
+}
+
+CompressionMethod ZipStreamReader::getCompressionMethod(void) const {
+    return convertCompressionFromLibzip(entryMethod);
+}
+
+bool ZipStreamReader::fill(libzippp_uint64 length) {
+    while (inputEnd-inputStart<length) {
+        if (inputStart>0) { //moves the unconsumed bytes at the beginning of the buffer
+            memmove(input.data(), input.data()+inputStart, inputEnd-inputStart);
+            inputEnd -= inputStart;
+            inputStart = 0;
+        }
+        if (input.size()<length) { input.resize(length); }
+
+        libzippp_int64 result = readFunc(input.data()+inputEnd, input.size()-inputEnd);
+        if (result<=0) { return false; }
+        inputEnd += (libzippp_uint64)result<input.size()-inputEnd ? result : input.size()-inputEnd;
+    }
+    return true;
+}
+
+void ZipStreamReader::consume(libzippp_uint64 length) {
+    inputStart += length;
+    consumed += length;
+}
+
+libzippp_int64 ZipStreamReader::fail(void) {
+    failed = true;
+    return LIBZIPPP_ERROR_FREAD_FAILURE;
+}
+
+int ZipStreamReader::nextEntry(void) {
+    if (failed) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+    if (ended) { return 0; }
+    if (entryOpen && !entryDone && !skipEntry()) {
+        return failed ? LIBZIPPP_ERROR_FREAD_FAILURE : LIBZIPPP_ERROR_INVALID_ENTRY;
+    }
+    entryOpen = false;
+
+    if (!fill(4)) { return (int)fail(); }
+    libzippp_uint32 signature = Helper::readUInt32(input.data()+inputStart);
+    if (signature==LIBZIPPP_CENTRAL_HEADER_SIGNATURE || signature==LIBZIPPP_EOCD_SIGNATURE || signature==LIBZIPPP_ZIP64_EOCD_SIGNATURE) {
+        ended = true;
+        return 0;
+    }
+    if (signature!=LIBZIPPP_LOCAL_HEADER_SIGNATURE || !fill(LIBZIPPP_LOCAL_HEADER_SIZE)) { return (int)fail(); }
+
+    libzippp_uint16 nameLength = Helper::readUInt16(input.data()+inputStart+26);
+    libzippp_uint16 extraLength = Helper::readUInt16(input.data()+inputStart+28);
+    libzippp_uint64 headerSize = LIBZIPPP_LOCAL_HEADER_SIZE+nameLength+extraLength;
+    if (!fill(headerSize)) { return (int)fail(); }
+
+    const libzippp_uint8* header = input.data()+inputStart;
+    entryFlags = Helper::readUInt16(header+6);
+    entryMethod = Helper::readUInt16(header+8);
+    entryTime = Helper::fromDosDateTime(Helper::readUInt16(header+10), Helper::readUInt16(header+12));
+    entryCrc = Helper::readUInt32(header+14);
+    entryCompSize = Helper::readUInt32(header+18);
+    entrySize = Helper::readUInt32(header+22);
+    entryName.assign(reinterpret_cast<const char*>(header+LIBZIPPP_LOCAL_HEADER_SIZE), nameLength);
+
+    //the Zip64 extra field holds the sizes that overflow, in this order
+    entryZip64 = false;
+    const libzippp_uint8* extra = header+LIBZIPPP_LOCAL_HEADER_SIZE+nameLength;
+    const libzippp_uint8* extraEnd = extra+extraLength;
+    while (extra+4<=extraEnd) {
+        libzippp_uint16 fieldId = Helper::readUInt16(extra);
+        libzippp_uint16 fieldSize = Helper::readUInt16(extra+2);
+        if (extra+4+fieldSize>extraEnd) { break; }
+        if (fieldId==LIBZIPPP_ZIP64_EXTRA_FIELD_ID) {
+            entryZip64 = true;
+            libzippp_uint16 fieldPos = 0;
+            if (entrySize==0xFFFFFFFF && fieldPos+8<=fieldSize) {
+                entrySize = Helper::readUInt64(extra+4+fieldPos);
+                fieldPos += 8;
+            }
+            if (entryCompSize==0xFFFFFFFF && fieldPos+8<=fieldSize) { entryCompSize = Helper::readUInt64(extra+4+fieldPos); }
+            break;
+        }
+        extra += 4+fieldSize;
+    }
+    consume(headerSize);
+
+    if (hasDataDescriptor()) { //known once the data has been read
+        entryCrc = 0;
+        entryCompSize = 0;
+        entrySize = 0;
+    }
+
+    if (entryMethod==ZIP_CM_DEFLATE && !isEncrypted()) {
+        if (stream==nullptr) {
+            stream = new z_stream();
+            if (inflateInit2(stream, -MAX_WBITS)!=Z_OK) {
+                delete stream;
+                stream = nullptr;
+                failed = true;
+                return LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+            }
+        } else if (inflateReset(stream)!=Z_OK) {
+            return (int)fail();
+        }
+    }
+
+    readSize = 0;
+    readCompSize = 0;
+    readCrc = crc32(0L, Z_NULL, 0);
+    entryOpen = true;
+    entryDone = false;
+    ++nbEntries;
+    return 1;
+}
+
+bool ZipStreamReader::skipEntry(void) {
+    //the remaining compressed data is skipped without being verified
+    if (!hasDataDescriptor()) {
+        while (readCompSize<entryCompSize) {
+            if (inputStart==inputEnd && !fill(1)) {
+                fail();
+                return false;
+            }
+            libzippp_uint64 length = inputEnd-inputStart<entryCompSize-readCompSize ? inputEnd-inputStart : entryCompSize-readCompSize;
+            consume(length);
+            readCompSize += length;
+        }
+        entryDone = true;
+        return true;
+    }
+
+    //the end of the data can only be found by reading it
+    if (isEncrypted() || (entryMethod!=ZIP_CM_STORE && entryMethod!=ZIP_CM_DEFLATE)) {
+        failed = true;
+        return false;
+    }
+    vector<libzippp_uint8> chunk(LIBZIPPP_INFLATE_INPUT_SIZE*4);
+    libzippp_int64 result;
+    do {
+        result = read(chunk.data(), chunk.size());
+    } while (result>0);
+    return result==0;
+}
+
+libzippp_int64 ZipStreamReader::read(void* buffer, libzippp_uint64 length) {
+    if (failed) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+    if (!entryOpen) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    if (buffer==nullptr) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+    if (entryDone || length==0) { return 0; }
+    if (isEncrypted()) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
+
+    if (entryMethod==ZIP_CM_STORE) { return readStored(static_cast<libzippp_uint8*>(buffer), length); }
+    if (entryMethod==ZIP_CM_DEFLATE) { return readDeflated(static_cast<libzippp_uint8*>(buffer), length); }
+    return LIBZIPPP_ERROR_INVALID_ENTRY;
+}
+
+libzippp_int64 ZipStreamReader::readStored(libzippp_uint8* buffer, libzippp_uint64 length) {
+    libzippp_uint64 count;
+    if (!hasDataDescriptor()) {
+        libzippp_uint64 remaining = entryCompSize-readCompSize;
+        if (remaining==0) { return finishEntry() ? 0 : fail(); }
+        if (!fill(1)) { return fail(); }
+        count = inputEnd-inputStart;
+        if (count>remaining) { count = remaining; }
+    } else {
+        //the data goes until a data descriptor matching it, its last 3 bytes being kept as they might start one
+        if (!fill(4)) { return fail(); }
+        const libzippp_uint8* data = input.data()+inputStart;
+        libzippp_uint64 available = inputEnd-inputStart-3;
+        count = 0;
+        while (count<available && count<length && Helper::readUInt32(data+count)!=LIBZIPPP_DATA_DESCRIPTOR_SIGNATURE) { ++count; }
+        if (count==0) {
+            if (matchDataDescriptor(4)>0) { return finishEntry() ? 0 : fail(); }
+            count = 1; //the signature is part of the data
+        }
+    }
+    if (count>length) { count = length; }
+
+    memcpy(buffer, input.data()+inputStart, count);
+    consume(count);
+    readCompSize += count;
+    readSize += count;
+    readCrc = crc32(readCrc, buffer, (uInt)count);
+    return count;
+}
+
+libzippp_int64 ZipStreamReader::readDeflated(libzippp_uint8* buffer, libzippp_uint64 length) {
+    uInt outputLength = length<LIBZIPPP_DEFAULT_CHUNK_SIZE ? (uInt)length : LIBZIPPP_DEFAULT_CHUNK_SIZE;
+    stream->next_out = buffer;
+    stream->avail_out = outputLength;
+
+    int result = Z_OK;
+    while (stream->avail_out==outputLength && result!=Z_STREAM_END) {
+        //the pending output of inflate may still be flushed once the compressed data has been entirely consumed
+        libzippp_uint64 remaining = hasDataDescriptor() ? input.size() : entryCompSize-readCompSize;
+        if (inputStart==inputEnd && remaining>0 && !fill(1)) { return fail(); }
+        libzippp_uint64 available = inputEnd-inputStart<remaining ? inputEnd-inputStart : remaining;
+
+        stream->next_in = input.data()+inputStart;
+        stream->avail_in = (uInt)available;
+        result = inflate(stream, Z_NO_FLUSH);
+        if (result!=Z_OK && result!=Z_STREAM_END) { return fail(); } //Z_BUF_ERROR: the data is longer than its compressed size
+        libzippp_uint64 used = available-stream->avail_in;
+        consume(used);
+        readCompSize += used;
+    }
+
+    libzippp_uint64 produced = outputLength-stream->avail_out;
+    readSize += produced;
+    readCrc = crc32(readCrc, buffer, (uInt)produced);
+    if (result==Z_STREAM_END && !finishEntry()) { return fail(); }
+    return produced;
+}
+
+libzippp_uint64 ZipStreamReader::matchDataDescriptor(libzippp_uint64 at) {
+    //the sizes are stored with 4 bytes, or with 8 bytes for the Zip64 entries and the ones that overflow
+    bool match32 = false;
+    if (!entryZip64 && readCompSize<0xFFFFFFFF && readSize<0xFFFFFFFF && fill(at+12)) {
+        const libzippp_uint8* descriptor = input.data()+inputStart+at;
+        match32 = Helper::readUInt32(descriptor)==readCrc && Helper::readUInt32(descriptor+4)==readCompSize && Helper::readUInt32(descriptor+8)==readSize;
+    }
+    bool match64 = false;
+    if (fill(at+20)) {
+        const libzippp_uint8* descriptor = input.data()+inputStart+at;
+        match64 = Helper::readUInt32(descriptor)==readCrc && Helper::readUInt64(descriptor+4)==readCompSize && Helper::readUInt64(descriptor+12)==readSize;
+    }
+
+    //both might match for an empty entry, the signature of the next record tells which one it is
+    if (match32 && match64) {
+        match64 = false;
+        if (fill(at+24)) {
+            libzippp_uint32 signature = Helper::readUInt32(input.data()+inputStart+at+20);
+            match64 = signature==LIBZIPPP_LOCAL_HEADER_SIGNATURE || signature==LIBZIPPP_CENTRAL_HEADER_SIGNATURE;
+        }
+    }
+    return match64 ? 20 : (match32 ? 12 : 0);
+}
+
+bool ZipStreamReader::readDataDescriptor(void) {
+    //the signature of the data descriptor is optional
+    libzippp_uint64 at = fill(4) && Helper::readUInt32(input.data()+inputStart)==LIBZIPPP_DATA_DESCRIPTOR_SIGNATURE ? 4 : 0;
+    libzippp_uint64 length = matchDataDescriptor(at);
+    if (length==0) { return false; }
+    consume(at+length);
+    return true;
+}
+
+bool ZipStreamReader::finishEntry(void) {
+    if (hasDataDescriptor()) {
+        if (!readDataDescriptor()) { return false; }
+        entryCrc = readCrc;
+        entryCompSize = readCompSize;
+        entrySize = readSize;
+    } else if (readCrc!=entryCrc || readCompSize!=entryCompSize || readSize!=entrySize) {
+        return false;
+    }
+    entryDone = true;
+    return true;
+}
+
+string ZipStreamReader::readAsText(void) {
+    string str;
+    if (!hasDataDescriptor() && entrySize>readSize) { str.reserve(entrySize-readSize); }
+
+    vector<char> chunk(LIBZIPPP_INFLATE_INPUT_SIZE*4);
+    libzippp_int64 result;
+    while ((result = read(chunk.data(), chunk.size()))>0) { str.append(chunk.data(), result); }
+    if (result<0) { str.clear(); }
+    return str;
+}
+
+int ZipStreamReader::readContent(std::ostream& ofOutput, libzippp_uint64 chunksize) {
+    if (chunksize==0) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; }
+    vector<char> chunk(chunksize);
+    while (true) {
+        libzippp_int64 result = read(chunk.data(), chunk.size());
+        if (result<0) { return (int)result; }
+        if (result==0) { return LIBZIPPP_OK; }
+        ofOutput.write(chunk.data(), result);
+        if (ofOutput.fail()) { return LIBZIPPP_ERROR_OWRITE_FAILURE; }
+    }
+}
+
+CompressionMethod ZipEntryTable::getCompressionMethod(libzippp_uint64 i) const {
+    return convertCompressionFromLibzip(compressionMethods[i]);
+}
+
+libzippp_uint64 ZipEntryTable::getNbEntries(CompressionMethod compMethod) const {
+    libzippp_uint64 count = 0;
+    for(vector<libzippp_uint16>::const_iterator it=compressionMethods.begin() ; it!=compressionMethods.end() ; ++it) {
+        if (convertCompressionFromLibzip(*it)==compMethod) { ++count; }
+    }
+    return count;
+}
+
+ZipArchive::ZipArchive(const string& zipPath, const string& password, Encryption encryptionMethod) : path(zipPath), zipHandle(nullptr), zipSource(nullptr), mode(NotOpen), password(password), progressPrecision(LIBZIPPP_DEFAULT_PROGRESSION_PRECISION), bufferData(nullptr), bufferLength(0), originalData(nullptr), originalDataLength(0), mappedData(nullptr), mappedLength(0), entryIndexEnabled(false), pathIndexLoaded(false), readAheadEnabled(false), inflateBackend(ZipInflateBackend::zlib()), entryCacheSize(0), entryCacheUsage(0), entryCacheHits(0), entryCacheMisses(0), compressionThreads(0), eagerCompressionEnabled(false), compressionPool(nullptr), pendingDataLimit(0), pendingDataSize(0), batchOpen(false), batchTime(0), appendCommitEnabled(false), appendable(false), lastCommitAppended(false), useArchiveCompressionMethod(false), compressionMethod(ZIP_CM_DEFAULT), compressionLevel(0), errorHandlingCallback(defaultErrorHandler) {
+    switch(encryptionMethod) {
+#ifdef LIBZIPPP_WITH_ENCRYPTION
+        case Encryption::Aes128:
+            this->encryptionMethod = ZIP_EM_AES_128;
+            break;
+        case Encryption::Aes192:
+            this->encryptionMethod = ZIP_EM_AES_192;
+            break;
+        case Encryption::Aes256:
+            this->encryptionMethod = ZIP_EM_AES_256;
+            break;
+        case Encryption::TradPkware:
+            this->encryptionMethod = ZIP_EM_TRAD_PKWARE;
+            break;
+#endif
+        case Encryption::None:
+        default:
+            this->encryptionMethod = ZIP_EM_NONE;
+            break;
+    }
+}
+
+ZipArchive::~ZipArchive(void) {
+    close(); /* discard ??? */
+
+    // ensures all the values are clared
+    zipHandle = nullptr;
+    zipSource = nullptr;
+    bufferData = nullptr;
+    errorHandlingCallback = nullptr;
+    listeners.clear();
+}
+
+void ZipArchive::free(ZipArchive* archive) {
+    delete archive;
+}
+
+ZipArchive* ZipArchive::fromBuffer(const void* data, libzippp_uint64 size, bool checkConsistency,
+                                   const std::string& password, Encryption encryptionMethod) {
+    void* mutableData = const_cast<void*>(data);
+    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
+    bool o = za->openBuffer(&mutableData, size, ZipArchive::ReadOnly, checkConsistency);
+    if (!o) {
+        delete za;
+        za = nullptr;
+    }
+    return za;
+}
+
+ZipArchive* ZipArchive::fromWritableBuffer(void** data, libzippp_uint64 size, OpenMode mode, bool checkConsistency,
+                                           const std::string& password, Encryption encryptionMethod) {
+    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
+    bool o = za->openBuffer(data, size, mode, checkConsistency);
+    if (!o) {
+        delete za;
+        za = nullptr;
+    }
+    return za;
+}
+
+ZipArchive* ZipArchive::fromMappedFile(const std::string& zipPath, bool checkConsistency,
+                                       const std::string& password, Encryption encryptionMethod) {
+    ZipArchive* za = new ZipArchive(zipPath, password, encryptionMethod);
+    bool o = za->openMappedFile(checkConsistency);
+    if (!o) {
+        delete za;
+        za = nullptr;
+    }
+    return za;
+}
+
+ZipArchive* ZipArchive::fromSource(zip_source* source, OpenMode om, bool checkConsistency,
+                                   const std::string& password, Encryption encryptionMethod) {
+    ZipArchive* za = new ZipArchive("", password, encryptionMethod);
+    bool o = za->openSource(source, om, checkConsistency);
+    if (!o) {
+        delete za;
+        za = nullptr;
+    }
+    return za;
+}
+
+bool ZipArchive::openBuffer(void** data, libzippp_uint64 size, OpenMode om, bool checkConsistency) {
+    zip_error_t error;
+    zip_error_init(&error);
+
+    /* create source from buffer */
+    zip_source* localZipSource = zip_source_buffer_create(*data, size, 0, &error);
+    if (localZipSource == nullptr) {
+        Helper::callErrorHandlingCallback(&error, "can't create zip source: %s\n", errorHandlingCallback);
+        zip_error_fini(&error);
+        return false;
+    }
+
+    bool open = openSource(localZipSource, om, checkConsistency);
+    if (open) {
+        originalData = *data;
+        originalDataLength = size;
+
+        if (om==Write || om==New) {
+            bufferData = data;
+            bufferLength = size;
+
+            //prevents libzip to delete the source when closing the ZipArchive
+            zip_source_keep(localZipSource);
+        }
+    } else {
+        zip_source_free(localZipSource);
+        localZipSource = nullptr;
+    }
+    return open;
+}
+
+bool ZipArchive::openMappedFile(bool checkConsistency) {
+    int systemError = 0;
+    libzippp_uint64 length = 0;
+    void* data = Helper::mapFile(path, &length, &systemError);
+    if (data==nullptr) {
+        Helper::callErrorHandlingCallbackFunc("unable to map archive: %s\n", ZIP_ER_OPEN, systemError, errorHandlingCallback);
+        return false;
+    }
+
+    bool open = openBuffer(&data, length, ReadOnly, checkConsistency);
+    if (open) {
+        mappedData = data;
+        mappedLength = length;
+    } else {
+        Helper::unmapFile(data, length);
+    }
+    return open;
+}
+
+void ZipArchive::unmapFile(void) {
+    if (mappedData!=nullptr) {
+        Helper::unmapFile(mappedData, mappedLength);
+        mappedData = nullptr;
+        mappedLength = 0;
+    }
+}
+
+bool ZipArchive::openSource(zip_source* source, OpenMode om, bool checkConsistency) {
+    int zipFlag = 0;
+    if (om == ReadOnly) { zipFlag = 0; }
+    else if (om == Write) { zipFlag = ZIP_CREATE; }
+    else if (om == New) { zipFlag = ZIP_CREATE | ZIP_TRUNCATE; }
+    else { return false; }
+    if (checkConsistency) {
+        zipFlag = zipFlag | ZIP_CHECKCONS;
+    }
+
+    zip_error_t error;
+    zip_error_init(&error);
+
+    /* open zip archive from source */
+    zipHandle = zip_open_from_source(source, zipFlag, &error);
+    if (zipHandle == nullptr) {
+        Helper::callErrorHandlingCallback(&error, "can't open zip from source: %s\n", errorHandlingCallback);
+        zip_error_fini(&error);
+        return false;
+    }
+    zip_error_fini(&error);
+
+    zipSource = source;
+
+#ifdef LIBZIPPP_WITH_ENCRYPTION
+    if (isEncrypted()) {
+        int result = zip_set_default_password(zipHandle, password.c_str());
+        if (result != 0) {
+            close();
+            return false;
+        }
+    }
+#endif
+
+    mode = om;
+    if (entryIndexEnabled) { buildEntryIndex(); }
+    return true;
+}
+
+bool ZipArchive::open(OpenMode om, bool checkConsistency) {
+    if (isOpen()) { return om==mode; }
+
+    int zipFlag = 0;
+    if (om==ReadOnly) { zipFlag = 0; }
+    else if (om==Write) { zipFlag = ZIP_CREATE; }
+    else if (om==New) { zipFlag = ZIP_CREATE | ZIP_TRUNCATE; }
+    else { return false; }
+
+    if (checkConsistency) {
+        zipFlag = zipFlag | ZIP_CHECKCONS;
+    }
+
+    int errorFlag = 0;
+    zipHandle = zip_open(path.c_str(), zipFlag, &errorFlag);
+
+    //error during opening of the file
+    if (errorFlag!=ZIP_ER_OK) {
+        zip_error_t error;
+        zip_error_init_with_code(&error, errorFlag);
+        Helper::callErrorHandlingCallback(&error, "unable to open archive: %s\n", errorHandlingCallback);
+        zip_error_fini(&error);
+
+        zipHandle = nullptr;
+        return false;
+    }
+
+    if (zipHandle!=nullptr) {
+#ifdef LIBZIPPP_WITH_ENCRYPTION
+        if (isEncrypted()) {
+            int result = zip_set_default_password(zipHandle, password.c_str());
+            if (result!=0) {
+                close();
+                return false;
+            }
+        }
+#endif
+
+        mode = om;
+        appendable = om==Write;
+        if (entryIndexEnabled) { buildEntryIndex(); }
+        return true;
+    }
+
+    return false;
+}
+
+void progress_callback(zip* /*archive*/, double progression, void* ud) {
     ZipArchive* za = static_cast<ZipArchive*>(ud);
     vector<ZipProgressListener*> listeners = za->getProgressListeners();
     for(vector<ZipProgressListener*>::const_iterator it=listeners.begin() ; it!=listeners.end() ; ++it) {
@@ -403,13 +2715,28 @@ int ZipArchive::close(void) {
             progress_callback(zipHandle, 0, this); //enforce the first progression call to be zero
         }
 
-        int result = zip_close(zipHandle);
-        if (result!=0) {
-            Helper::callErrorHandlingCallback(zipHandle, "unable to close archive: %s\n", errorHandlingCallback);
-            return LIBZIPPP_ERROR_HANDLE_FAILURE;
+        lastCommitAppended = isAppendCommitPossible() && commitAppend();
+        if (lastCommitAppended) {
+            zip_discard(zipHandle); //the changes have already been written in the file
+        } else {
+            submitCompressionJobs();
+
+            int result = zip_close(zipHandle);
+            if (result!=0) {
+                Helper::callErrorHandlingCallback(zipHandle, "unable to close archive: %s\n", errorHandlingCallback);
+                return LIBZIPPP_ERROR_HANDLE_FAILURE;
+            }
         }
 
         zipHandle = nullptr;
+        compressionJobs.clear();
+        delete compressionPool; //all the sources have been released by zip_close
+        compressionPool = nullptr;
+        pendingData.clear();
+        pendingDataSize = 0;
+        endBatch();
+        addedEntries.clear();
+        appendable = false;
         progress_callback(zipHandle, 1, this); //enforce the last progression call to be one
 
         //push back the changes in the buffer
@@ -417,36 +2744,54 @@ int ZipArchive::close(void) {
         if (bufferData!=nullptr && (mode==New || mode==Write)) {
             int srcOpen = zip_source_open(zipSource);
             if (srcOpen==0) {
-                void* sourceBuffer = *bufferData;
-                void* tempBuffer = sourceBuffer;
-                zip_int64_t increment = 1024;
-                zip_int64_t tempBufferSize = bufferLength;
-                zip_int64_t read = zip_source_read(zipSource, tempBuffer, tempBufferSize);
-                zip_int64_t totalRead = 0;
-                while(read>0) {
-                    totalRead += read;
-                    tempBufferSize -= read;
-                    if (tempBufferSize<=0) {
-                        zip_int64_t newLength = bufferLength + increment;
-                        sourceBuffer = realloc(sourceBuffer, newLength * sizeof(char));
-                        if (sourceBuffer==nullptr) {
-                            Helper::callErrorHandlingCallback(zipHandle, "can't read back from source: unable to extend buffer\n", errorHandlingCallback);
-                            return LIBZIPPP_ERROR_MEMORY_ALLOCATION;
-                        }
+                //the size of the new archive is known by the source, hence the buffer is extended at most once
+                libzippp_uint64 capacity = bufferLength;
+                zip_stat_t stat;
+                zip_stat_init(&stat);
+                if (zip_source_stat(zipSource, &stat)==0 && (stat.valid & ZIP_STAT_SIZE) && stat.size>capacity) {
+                    void* newBuffer = realloc(*bufferData, stat.size);
+                    if (newBuffer!=nullptr) {
+                        *bufferData = newBuffer;
+                        capacity = stat.size;
+                    }
+                }
 
-                        tempBuffer = static_cast<char*>(sourceBuffer)+bufferLength;
-                        tempBufferSize = increment;
-                        bufferLength = newLength;
+                libzippp_uint64 totalRead = 0;
+                while (true) {
+                    zip_int64_t read;
+                    if (totalRead<capacity) {
+                        read = zip_source_read(zipSource, static_cast<char*>(*bufferData)+totalRead, capacity-totalRead);
                     } else {
-                        tempBuffer = static_cast<char*>(tempBuffer)+read;
+                        //the buffer is only extended (geometrically) if there is more data to read
+                        char next;
+                        read = zip_source_read(zipSource, &next, 1);
+                        if (read>0) {
+                            libzippp_uint64 newCapacity = capacity<LIBZIPPP_MIN_BUFFER_CAPACITY ? LIBZIPPP_MIN_BUFFER_CAPACITY : capacity*2;
+                            void* newBuffer = realloc(*bufferData, newCapacity);
+                            if (newBuffer==nullptr) {
+                                Helper::callErrorHandlingCallback((zip*)nullptr, "can't read back from source: unable to extend buffer\n", errorHandlingCallback);
+                                res_code = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+                                break;
+                            }
+                            *bufferData = newBuffer;
+                            capacity = newCapacity;
+                            static_cast<char*>(*bufferData)[totalRead] = next;
+                        }
                     }
-                    read = zip_source_read(zipSource, tempBuffer, tempBufferSize);
+
+                    if (read<0) {
+                        Helper::callErrorHandlingCallback(zip_source_error(zipSource), "can't read back from source: %s\n", errorHandlingCallback);
+                        res_code = LIBZIPPP_ERROR_HANDLE_FAILURE;
+                        break;
+                    }
+                    if (read==0) { break; }
+                    totalRead += read;
                 }
 
                 zip_source_close(zipSource);
 
-                *bufferData = sourceBuffer;
-                bufferLength = totalRead;
+                //the length is left unchanged if the buffer couldn't be entirely written
+                if (res_code==LIBZIPPP_OK) { bufferLength = totalRead; }
             } else {
                 Helper::callErrorHandlingCallback((zip*)nullptr, "can't read back from source: changes were not pushed in the buffer\n", errorHandlingCallback);
                 res_code = LIBZIPPP_ERROR_HANDLE_FAILURE;
@@ -456,6 +2801,16 @@ int ZipArchive::close(void) {
             zipSource = nullptr;
         }
 
+        //the source over the mapping has been released by zip_close
+        unmapFile();
+
+        originalData = nullptr;
+        originalDataLength = 0;
+        localHeaderOffsets.clear();
+        entryIndex.clear();
+        pathIndex.clear();
+        pathIndexLoaded = false;
+        evictCachedEntries(0);
         mode = NotOpen;
         return res_code;
     }
@@ -467,12 +2822,29 @@ void ZipArchive::discard(void) {
     if (isOpen()) {
         zip_discard(zipHandle);
         zipHandle = nullptr;
+        compressionJobs.clear();
+        delete compressionPool;
+        compressionPool = nullptr;
+        pendingData.clear();
+        pendingDataSize = 0;
+        endBatch();
+        addedEntries.clear();
+        appendable = false;
 
         if (bufferData!=nullptr && (mode==New || mode==Write)) {
             zip_source_free(zipSource);
             zipSource = nullptr;
         }
 
+        unmapFile();
+
+        originalData = nullptr;
+        originalDataLength = 0;
+        localHeaderOffsets.clear();
+        entryIndex.clear();
+        pathIndex.clear();
+        pathIndexLoaded = false;
+        evictCachedEntries(0);
         mode = NotOpen;
     }
 }
@@ -503,6 +2875,7 @@ bool ZipArchive::setComment(const string& comment) const {
     string::size_type size = comment.size();
     const char* data = comment.c_str();
     int result = zip_set_archive_comment(zipHandle, data, (zip_uint16_t)size);
+    if (result==0) { appendable = false; } //the comments are not appended
     return result==0;
 }
 
@@ -516,6 +2889,10 @@ bool ZipArchive::setEntryCompressionConfig(ZipEntry& entry, CompressionMethod co
     if (success) {
         entry.compressionMethod = comp_libzip;
         entry.compressionLevel = level;
+        scheduleCompression(entry.index, nullptr); //the pool only uses the default configuration
+        trackChange(entry.index);
+        if (level==0) { trackAddedEntry(entry.index, comp_libzip); }
+        else { appendable = false; }
     }
     return success;
 }
@@ -566,8 +2943,23 @@ vector<ZipEntry> ZipArchive::getEntries(State state) const {
     return entries;
 }
 
-bool ZipArchive::hasEntry(const string& name, bool excludeDirectories, bool caseSensitive, State state) const {
-    if (!isOpen()) { return false; }
+libzippp_int64 ZipArchive::locateEntry(const char* name, libzippp_uint64 length, bool excludeDirectories, bool caseSensitive, State state) const {
+    if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+
+    if (entryIndexEnabled && !excludeDirectories && state==Current) {
+        libzippp_int64 index = -1;
+        typedef std::unordered_multimap<libzippp_uint64, libzippp_uint64>::const_iterator IndexIterator;
+        std::pair<IndexIterator, IndexIterator> range = entryIndex.equal_range(Helper::hashEntryName(name, length));
+        for(IndexIterator it=range.first ; it!=range.second ; ++it) {
+            libzippp_int64 candidate = (libzippp_int64)it->second;
+            if (index>=0 && candidate>index) { continue; } //zip_name_locate returns the first matching entry
+            const char* entryName = zip_get_name(zipHandle, it->second, ZIP_FL_ENC_GUESS);
+            if (entryName!=nullptr && Helper::entryNameEquals(entryName, name, length, caseSensitive)) {
+                index = candidate;
+            }
+        }
+        return index;
+    }
 
     int flags = 0;
     if (excludeDirectories) { flags = flags | ZIP_FL_NODIR; }
@@ -575,19 +2967,140 @@ bool ZipArchive::hasEntry(const string& name, bool excludeDirectories, bool case
     if (state==Original) { flags = flags | LIBZIPPP_ORIGINAL_STATE_FLAGS; }
     else { flags = flags | ZIP_FL_ENC_GUESS; }
 
-    libzippp_int64 index = zip_name_locate(zipHandle, name.c_str(), flags);
+    string str(name, length); //zip_name_locate needs a null-terminated string
+    return zip_name_locate(zipHandle, str.c_str(), flags);
+}
+
+ZipEntryRange ZipArchive::iterateEntries(State state, libzippp_int64 first, libzippp_int64 last) const {
+    libzippp_int64 nbEntries = isOpen() ? getNbEntries(state) : 0;
+    if (last<0 || last>nbEntries) { last = nbEntries; }
+    if (first<0) { first = 0; }
+    if (first>last) { first = last; }
+    return ZipEntryRange(this, first, last, state);
+}
+
+ZipEntryTable ZipArchive::getEntryTable(State state) const {
+    ZipEntryTable table;
+    if (!isOpen()) { return table; }
+
+    libzippp_int64 nbEntries = getNbEntries(state);
+    table.nameOffsets.reserve(nbEntries+1);
+    table.indexes.reserve(nbEntries);
+    table.times.reserve(nbEntries);
+    table.sizes.reserve(nbEntries);
+    table.deflatedSizes.reserve(nbEntries);
+    table.crcs.reserve(nbEntries);
+    table.compressionMethods.reserve(nbEntries);
+    table.encryptionMethods.reserve(nbEntries);
+    table.nameOffsets.push_back(0);
+
+    //the offsets are only known for the original content of the archive
+    bool withOffsets = (mode==ReadOnly || state==Original) && loadLocalHeaderOffsets();
+    if (withOffsets) { table.offsets.reserve(nbEntries); }
+
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+    for(libzippp_int64 i=0 ; i<nbEntries ; ++i) {
+        int result = zip_stat_index(zipHandle, i, flag, &stat);
+        if (result==0) {
+            size_t nameLength = strlen(stat.name);
+            table.names.append(stat.name, nameLength+1);
+            table.nameOffsets.push_back(table.names.size());
+            table.indexes.push_back(stat.index);
+            table.times.push_back(stat.mtime);
+            table.sizes.push_back(stat.size);
+            table.deflatedSizes.push_back(stat.comp_size);
+            table.crcs.push_back(stat.crc);
+            table.compressionMethods.push_back(useArchiveCompressionMethod ? compressionMethod : stat.comp_method);
+            table.encryptionMethods.push_back(stat.encryption_method);
+
+            table.totalSize += stat.size;
+            table.totalDeflatedSize += stat.comp_size;
+            if (nameLength>0 && stat.name[nameLength-1]==LIBZIPPP_ENTRY_PATH_SEPARATOR) { ++table.nbDirectories; }
+
+            if (withOffsets) {
+                withOffsets = stat.index<localHeaderOffsets.size();
+                if (withOffsets) { table.offsets.push_back(localHeaderOffsets[stat.index]); }
+                else { table.offsets.clear(); }
+            }
+        }
+    }
+    return table;
+}
+
+vector<ZipEntry> ZipArchive::getEntriesWithPrefix(const string& prefix, State state) const {
+    vector<ZipEntry> entries;
+    if (!isOpen()) { return entries; }
+
+    vector<libzippp_uint64> indexes;
+    findEntries(prefix, nullptr, state, indexes);
+    entries.reserve(indexes.size());
+    for(vector<libzippp_uint64>::const_iterator it=indexes.begin() ; it!=indexes.end() ; ++it) {
+        entries.push_back(getEntry(*it, state));
+    }
+    return entries;
+}
+
+vector<ZipEntry> ZipArchive::getEntriesMatching(const string& pattern, State state) const {
+    vector<ZipEntry> entries;
+    if (!isOpen()) { return entries; }
+
+    vector<libzippp_uint64> indexes;
+    findEntries(pattern.substr(0, pattern.find_first_of("*?")), &pattern, state, indexes);
+    entries.reserve(indexes.size());
+    for(vector<libzippp_uint64>::const_iterator it=indexes.begin() ; it!=indexes.end() ; ++it) {
+        entries.push_back(getEntry(*it, state));
+    }
+    return entries;
+}
+
+void ZipArchive::findEntries(const string& prefix, const string* pattern, State state, vector<libzippp_uint64>& indexes) const {
+    const char* patternStart = pattern!=nullptr ? pattern->data() : nullptr;
+    const char* patternEnd = pattern!=nullptr ? pattern->data()+pattern->length() : nullptr;
+
+    if (state==Current) {
+        if (!pathIndexLoaded) { buildPathIndex(); }
+
+        typedef std::multimap<string, libzippp_uint64>::const_iterator PathIterator;
+        for(PathIterator it=pathIndex.lower_bound(prefix) ; it!=pathIndex.end() ; ++it) {
+            const string& name = it->first;
+            if (name.compare(0, prefix.length(), prefix)!=0) { break; } //past the entries with the prefix
+            if (pattern==nullptr || Helper::matchPattern(patternStart, patternEnd, name.data(), name.data()+name.length())) {
+                indexes.push_back(it->second);
+            }
+        }
+        return;
+    }
+
+    //the original entries are not indexed
+    vector<std::pair<string, libzippp_uint64> > matches;
+    libzippp_int64 nbEntries = getNbEntries(state);
+    for(libzippp_int64 i=0 ; i<nbEntries ; ++i) {
+        const char* name = zip_get_name(zipHandle, i, LIBZIPPP_ORIGINAL_STATE_FLAGS);
+        if (name==nullptr || strncmp(name, prefix.c_str(), prefix.length())!=0) { continue; }
+        if (pattern==nullptr || Helper::matchPattern(patternStart, patternEnd, name, name+strlen(name))) {
+            matches.push_back(std::make_pair(string(name), (libzippp_uint64)i));
+        }
+    }
+
+    std::sort(matches.begin(), matches.end());
+    indexes.reserve(indexes.size()+matches.size());
+    for(vector<std::pair<string, libzippp_uint64> >::const_iterator it=matches.begin() ; it!=matches.end() ; ++it) {
+        indexes.push_back(it->second);
+    }
+}
+
+bool ZipArchive::hasEntry(const string& name, bool excludeDirectories, bool caseSensitive, State state) const {
+    if (!isOpen()) { return false; }
+
+    libzippp_int64 index = locateEntry(name.c_str(), name.length(), excludeDirectories, caseSensitive, state);
     return index>=0;
 }
 
 ZipEntry ZipArchive::getEntry(const string& name, bool excludeDirectories, bool caseSensitive, State state) const {
     if (isOpen()) {
-        int flags = 0;
-        if (excludeDirectories) { flags = flags | ZIP_FL_NODIR; }
-        if (!caseSensitive) { flags = flags | ZIP_FL_NOCASE; }
-        if (state==Original) { flags = flags | LIBZIPPP_ORIGINAL_STATE_FLAGS; }
-        else { flags = flags | ZIP_FL_ENC_GUESS; }
-
-        libzippp_int64 index = zip_name_locate(zipHandle, name.c_str(), flags);
+        libzippp_int64 index = locateEntry(name.c_str(), name.length(), excludeDirectories, caseSensitive, state);
         if (index>=0) {
             return getEntry(index);
         } else {
@@ -631,6 +3144,7 @@ bool ZipArchive::setEntryComment(const ZipEntry& entry, const string& comment) c
     if (entry.zipFile!=this) { return false; }
 
     bool result = zip_file_set_comment(zipHandle, entry.getIndex(), comment.c_str(), (zip_uint16_t)comment.size(), ZIP_FL_ENC_GUESS) != 0;
+    if (result==0) { appendable = false; } //the comments are not appended
     return result==0;
 }
 
@@ -638,35 +3152,145 @@ void* ZipArchive::readEntry(const ZipEntry& zipEntry, bool asText, State state,
     if (!isOpen()) { return nullptr; }
     if (zipEntry.zipFile!=this) { return nullptr; }
 
-    int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
-    struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), flag);
-    if (zipFile) {
-        libzippp_uint64 maxSize = zipEntry.getSize();
-        libzippp_uint64 uisize = size==0 || size>maxSize ? maxSize : size;
+    libzippp_uint64 maxSize = zipEntry.getSize();
+    libzippp_uint64 uisize = size==0 || size>maxSize ? maxSize : size;
 
-        char* data = NEW_CHAR_ARRAY(uisize+(asText ? 1 : 0))
-        if (!data) { //allocation error
-            zip_fclose(zipFile);
-            return nullptr;
+    char* data = NEW_CHAR_ARRAY(uisize+(asText ? 1 : 0))
+    if (!data) { return nullptr; } //allocation error
+
+    libzippp_int64 result = readEntryInto(zipEntry, data, uisize, state);
+    if (result<0) { //unable to read the entry
+        delete[] data;
+        return nullptr;
+    }
+
+    //avoid buffer copy
+    if (asText) { data[uisize] = '\0'; }
+    return data;
+}
+
+libzippp_int64 ZipArchive::readEntryInto(const ZipEntry& zipEntry, void* buffer, libzippp_uint64 capacity, State state) const {
+    if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+    if (zipEntry.zipFile!=this) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    if (buffer==nullptr) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+
+    libzippp_uint64 maxSize = zipEntry.getSize();
+    libzippp_uint64 length = capacity<maxSize ? capacity : maxSize;
+
+    if (entryCacheSize>0) {
+        std::shared_ptr<const vector<char> > cached = findCachedEntry(zipEntry, state, true);
+        if (cached) {
+            if (length>0) { memcpy(buffer, cached->data(), length); }
+            return length;
         }
+    }
+
+    libzippp_int64 result = length;
+    if (length==0 || length!=maxSize || !inflateEntry(zipEntry, buffer, state)) {
+        int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+        struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), flag);
+        if (zipFile==nullptr) { return LIBZIPPP_ERROR_FOPEN_FAILURE; }
 
-        libzippp_int64 result = zip_fread(zipFile, data, uisize);
+        result = length>0 ? zip_fread(zipFile, buffer, length) : 0;
         zip_fclose(zipFile);
+    }
 
-        //avoid buffer copy
-        if (asText) { data[uisize] = '\0'; }
+    if (result!=(libzippp_int64)length) { return LIBZIPPP_ERROR_FREAD_FAILURE; }
+    if (entryCacheSize>0 && length==maxSize) { cacheEntry(zipEntry, state, buffer); }
+    return result;
+}
 
-        libzippp_int64 isize = (libzippp_int64)uisize;
-        if (result==isize) {
-            return data;
-        } else { //unexpected number of bytes read => crash ?
-            delete[] data;
+int ZipArchive::readEntryInto(const ZipEntry& zipEntry, string& output, State state, libzippp_uint64 size) const {
+    if (isOpen() && zipEntry.zipFile!=this) { output.clear(); return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    return Helper::readEntryInto(*this, zipEntry, output, state, size);
+}
+
+int ZipArchive::readEntryInto(const ZipEntry& zipEntry, vector<libzippp_uint8>& output, State state, libzippp_uint64 size) const {
+    if (isOpen() && zipEntry.zipFile!=this) { output.clear(); return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    return Helper::readEntryInto(*this, zipEntry, output, state, size);
+}
+
+bool ZipArchive::loadLocalHeaderOffsets(void) const {
+    if (!localHeaderOffsets.empty()) { return true; }
+
+    bool loaded = false;
+    if (originalData!=nullptr) {
+        loaded = Helper::readLocalHeaderOffsets(static_cast<const libzippp_uint8*>(originalData), originalDataLength, localHeaderOffsets);
+    } else if (!path.empty()) {
+        //only the pages holding the central directory will actually be read
+        int systemError = 0;
+        libzippp_uint64 length = 0;
+        void* data = Helper::mapFile(path, &length, &systemError);
+        if (data!=nullptr) {
+            loaded = Helper::readLocalHeaderOffsets(static_cast<const libzippp_uint8*>(data), length, localHeaderOffsets);
+            Helper::unmapFile(data, length);
         }
-    } else {
-        //unable to read the entry => crash ?
     }
 
-    return nullptr;
+    if (!loaded) { localHeaderOffsets.clear(); }
+    return loaded && !localHeaderOffsets.empty();
+}
+
+const void* ZipArchive::readEntryView(const ZipEntry& zipEntry, State state) const {
+    if (!isOpen()) { return nullptr; }
+    if (zipEntry.zipFile!=this) { return nullptr; }
+    if (originalData==nullptr) { return nullptr; } //not created from in-memory data
+    if (mode!=ReadOnly && state!=Original) { return nullptr; } //the current content is only known by libzip
+
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    if (zip_stat_index(zipHandle, zipEntry.getIndex(), LIBZIPPP_ORIGINAL_STATE_FLAGS, &stat)!=0) { return nullptr; }
+    if (stat.comp_method!=ZIP_CM_STORE || stat.encryption_method!=ZIP_EM_NONE || stat.size!=stat.comp_size) { return nullptr; }
+
+    return findOriginalData(zipEntry.getIndex(), stat.size);
+}
+
+const void* ZipArchive::findOriginalData(libzippp_uint64 index, libzippp_uint64 length) const {
+    if (originalData==nullptr) { return nullptr; }
+    if (!loadLocalHeaderOffsets()) { return nullptr; }
+    if (index>=localHeaderOffsets.size()) { return nullptr; }
+
+    const libzippp_uint8* data = static_cast<const libzippp_uint8*>(originalData);
+
+    libzippp_uint64 offset = localHeaderOffsets[index];
+    if (offset>originalDataLength || originalDataLength-offset<LIBZIPPP_LOCAL_HEADER_SIZE) { return nullptr; }
+    const libzippp_uint8* header = data+offset;
+    if (Helper::readUInt32(header)!=LIBZIPPP_LOCAL_HEADER_SIGNATURE) { return nullptr; }
+
+    libzippp_uint64 dataOffset = offset+LIBZIPPP_LOCAL_HEADER_SIZE+Helper::readUInt16(header+26)+Helper::readUInt16(header+28);
+    if (dataOffset>originalDataLength || originalDataLength-dataOffset<length) { return nullptr; }
+    return data+dataOffset;
+}
+
+bool ZipArchive::inflateEntry(const ZipEntry& zipEntry, void* buffer, State state) const {
+    if (inflateBackend==nullptr) { return false; }
+    if (mode!=ReadOnly && state!=Original) { return false; } //the current content is only known by libzip
+
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    if (zip_stat_index(zipHandle, zipEntry.getIndex(), LIBZIPPP_ORIGINAL_STATE_FLAGS, &stat)!=0) { return false; }
+    libzippp_uint64 needed = ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE | ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC | ZIP_STAT_ENCRYPTION_METHOD;
+    if ((stat.valid & needed)!=needed) { return false; }
+    if (stat.comp_method!=ZIP_CM_DEFLATE || stat.encryption_method!=ZIP_EM_NONE || stat.size!=zipEntry.getSize()) { return false; }
+
+    //the compressed data is taken as is from memory, or read without being inflated by libzip
+    vector<char> compressed;
+    const void* input = findOriginalData(zipEntry.getIndex(), stat.comp_size);
+    if (input==nullptr) {
+        //a copy of the whole compressed data inflated by zlib wouldn't be faster than the streaming of libzip
+        if (inflateBackend==ZipInflateBackend::zlib()) { return false; }
+
+        struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), ZIP_FL_COMPRESSED | LIBZIPPP_ORIGINAL_STATE_FLAGS);
+        if (zipFile==nullptr) { return false; }
+        compressed.resize((size_t)stat.comp_size);
+        libzippp_int64 result = stat.comp_size>0 ? zip_fread(zipFile, compressed.data(), stat.comp_size) : 0;
+        zip_fclose(zipFile);
+        if (result!=(libzippp_int64)stat.comp_size) { return false; }
+        input = compressed.data();
+    }
+
+    if (!inflateBackend->inflate(input, stat.comp_size, buffer, stat.size)) { return false; }
+    return inflateBackend->crc32(buffer, stat.size)==stat.crc;
 }
 
 void* ZipArchive::readEntry(const string& zipEntry, bool asText, State state, libzippp_uint64 size) const {
@@ -681,21 +3305,36 @@ int ZipArchive::deleteEntry(const ZipEntry& entry) const {
     if (mode==ReadOnly) { return LIBZIPPP_ERROR_NOT_ALLOWED; } //deletion not allowed
 
     if (entry.isFile()) {
+        unindexEntry(entry.getIndex());
         int result = zip_delete(zipHandle, entry.getIndex());
-        if (result==0) { return 1; }
+        if (result==0) {
+            uncacheEntry(entry.getIndex());
+            releasePendingData(entry.getIndex());
+            scheduleCompression(entry.getIndex(), nullptr);
+            trackChange(entry.getIndex());
+            addedEntries.erase(entry.getIndex());
+            return 1;
+        }
+        indexEntry(entry.getIndex());
         return LIBZIPPP_ERROR_UNKNOWN; //unable to delete the entry
     } else {
+        batchDirectories.clear(); //the directory and its sub-directories won't exist anymore
         int counter = 0;
-        vector<ZipEntry> allEntries = getEntries();
-        vector<ZipEntry>::const_iterator eit;
-        for(eit=allEntries.begin() ; eit!=allEntries.end() ; ++eit) {
-            ZipEntry ze = *eit;
-            string::size_type startPosition = ze.getName().find(entry.getName());
-            if (startPosition==0) {
-                int result = zip_delete(zipHandle, ze.getIndex());
-                if (result==0) { ++counter; }
-                else { return LIBZIPPP_ERROR_UNKNOWN; } //unable to remove the current entry
+        vector<libzippp_uint64> indexes;
+        findEntries(entry.getName(), nullptr, Current, indexes);
+        vector<libzippp_uint64>::const_iterator eit;
+        for(eit=indexes.begin() ; eit!=indexes.end() ; ++eit) {
+            unindexEntry(*eit);
+            int result = zip_delete(zipHandle, *eit);
+            if (result==0) {
+                uncacheEntry(*eit);
+                releasePendingData(*eit);
+                scheduleCompression(*eit, nullptr);
+                trackChange(*eit);
+                addedEntries.erase(*eit);
+                ++counter;
             }
+            else { indexEntry(*eit); return LIBZIPPP_ERROR_UNKNOWN; } //unable to remove the current entry
         }
         return counter;
     }
@@ -723,11 +3362,17 @@ int ZipArchive::renameEntry(const ZipEntry& entry, const string& newName) const
             if (!dadded) { return LIBZIPPP_ERROR_UNKNOWN; } //the hierarchy hasn't been created
         }
 
+        unindexEntry(entry.getIndex());
         int result = zip_file_rename(zipHandle, entry.getIndex(), newName.c_str(), ZIP_FL_ENC_GUESS);
-        if (result==0) { return 1; }
+        indexEntry(entry.getIndex());
+        if (result==0) {
+            trackChange(entry.getIndex());
+            return 1;
+        }
         return LIBZIPPP_ERROR_UNKNOWN; //renaming was not possible (entry already exists ?)
     } else {
         if (!LIBZIPPP_ENTRY_IS_DIRECTORY(newName)) { return LIBZIPPP_ERROR_INVALID_PARAMETER; } //invalid new name
+        batchDirectories.clear(); //the directory and its sub-directories will be moved
 
       string::size_type parentSlash = newName.rfind(LIBZIPPP_ENTRY_PATH_SEPARATOR, newName.length()-2);
         if (parentSlash!=string::npos) { //updates the dir hierarchy
@@ -736,52 +3381,192 @@ int ZipArchive::renameEntry(const ZipEntry& entry, const string& newName) const
             if (!dadded) { return LIBZIPPP_ERROR_UNKNOWN; }
         }
 
-        int counter = 0;
-        string originalName = entry.getName();
-        vector<ZipEntry> allEntries = getEntries();
-        vector<ZipEntry>::const_iterator eit;
-        for(eit=allEntries.begin() ; eit!=allEntries.end() ; ++eit) {
-            ZipEntry ze = *eit;
-            string currentName = ze.getName();
-
-            string::size_type startPosition = currentName.find(originalName);
-            if (startPosition==0) {
-                if (currentName == originalName) {
-                    int result = zip_file_rename(zipHandle, entry.getIndex(), newName.c_str(), ZIP_FL_ENC_GUESS);
-                    if (result==0) { ++counter; }
-                    else { return LIBZIPPP_ERROR_UNKNOWN;  } //unable to rename the folder
-                } else  {
-                    string targetName = currentName.replace(0, originalName.length(), newName);
-                    int result = zip_file_rename(zipHandle, ze.getIndex(), targetName.c_str(), ZIP_FL_ENC_GUESS);
-                    if (result==0) { ++counter; }
-                    else { return LIBZIPPP_ERROR_UNKNOWN; } //unable to rename a sub-entry
-                }
-            } else {
-                //file not affected by the renaming
+        int counter = 0;
+        string originalName = entry.getName();
+        vector<libzippp_uint64> indexes;
+        findEntries(originalName, nullptr, Current, indexes);
+        vector<libzippp_uint64>::const_iterator eit;
+        for(eit=indexes.begin() ; eit!=indexes.end() ; ++eit) {
+            const char* name = zip_get_name(zipHandle, *eit, ZIP_FL_ENC_GUESS);
+            if (name==nullptr) { return LIBZIPPP_ERROR_UNKNOWN; }
+            string currentName = name;
+
+            if (currentName == originalName) {
+                unindexEntry(entry.getIndex());
+                int result = zip_file_rename(zipHandle, entry.getIndex(), newName.c_str(), ZIP_FL_ENC_GUESS);
+                indexEntry(entry.getIndex());
+                if (result==0) { trackChange(entry.getIndex()); ++counter; }
+                else { return LIBZIPPP_ERROR_UNKNOWN;  } //unable to rename the folder
+            } else  {
+                string targetName = currentName.replace(0, originalName.length(), newName);
+                unindexEntry(*eit);
+                int result = zip_file_rename(zipHandle, *eit, targetName.c_str(), ZIP_FL_ENC_GUESS);
+                indexEntry(*eit);
+                if (result==0) { trackChange(*eit); ++counter; }
+                else { return LIBZIPPP_ERROR_UNKNOWN; } //unable to rename a sub-entry
+            }
+        }
+
+        /*
+         * Special case for moving a directory a/x to a/x/y to avoid to lose
+         * the a/x path in the archive.
+         */
+        bool newNameIsInsideCurrent = (newName.find(entry.getName())==0);
+        if (newNameIsInsideCurrent) {
+            bool dadded = addEntry(newName);
+            if (!dadded) { return LIBZIPPP_ERROR_UNKNOWN; }
+        }
+
+        return counter;
+    }
+}
+
+int ZipArchive::renameEntry(const string& e, const string& newName) const {
+    ZipEntry entry = getEntry(e);
+    if (entry.isNull()) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+    return renameEntry(entry, newName);
+}
+
+bool ZipArchive::addFile(const string& entryName, const string& file) const {
+    if (!isOpen()) { return false; }
+    if (mode==ReadOnly) { return false; } //adding not allowed
+    if (LIBZIPPP_ENTRY_IS_DIRECTORY(entryName)) { return false; }
+
+    string::size_type lastSlash = entryName.rfind(LIBZIPPP_ENTRY_PATH_SEPARATOR);
+    if (lastSlash!=string::npos) { //creates the needed parent directories
+        string dirEntry = entryName.substr(0, lastSlash+1);
+        bool dadded = addEntry(dirEntry);
+        if (!dadded) { return false; }
+    }
+
+    const char* filepath = file.c_str();
+    zip_source* source = zip_source_file(zipHandle, filepath, 0, -1);
+    if (source==nullptr) { return false; } //unable to create the zip_source
+
+    //the mode of the file is only needed when the entry isn't written from the libzip file source, and the large
+    //files are compressed by libzip, which streams them instead of holding their compressed data
+    std::shared_ptr<ZipCompressionJob> job;
+    libzippp_uint32 fileMode = 0;
+    bool poolEnabled = isCompressionPoolEnabled();
+    if (appendCommitEnabled || poolEnabled) {
+        libzippp_uint64 size = 0;
+        bool known = Helper::statFile(file, &size, &fileMode);
+        if (poolEnabled && known && size<=LIBZIPPP_POOL_MAX_ENTRY_SIZE) { job = std::make_shared<ZipCompressionJob>(file, fileMode); }
+    }
+    return addFileSource(entryName, source, job, addedEntryTime(), fileMode);
+}
+
+bool ZipArchive::addFileSource(const string& entryName, zip_source* source, const std::shared_ptr<ZipCompressionJob>& job, time_t mtime, libzippp_uint32 fileMode) const {
+    libzippp_int64 result = zip_file_add(zipHandle, entryName.c_str(), source, ZIP_FL_OVERWRITE);
+    if (result<0) {
+        zip_source_free(source); //unable to add the file
+        return false;
+    }
+
+    indexEntry(result);
+    uncacheEntry(result); //overwritten entry
+    releasePendingData(result);
+    scheduleCompression(result, job);
+    trackAddedEntry(result, useArchiveCompressionMethod ? compressionMethod : (libzippp_uint16)ZIP_CM_DEFAULT);
+    zip_file_set_mtime(zipHandle, result, mtime, 0);
+    if (fileMode!=0) { //set now, libzip only gets the attributes from the source when the archive is written
+        zip_file_set_external_attributes(zipHandle, result, 0, ZIP_OPSYS_UNIX, Helper::fileAttributes(fileMode));
+    }
+    if (useArchiveCompressionMethod) {
+      zip_set_file_compression(zipHandle, result, compressionMethod, 0);
+    }
+#ifdef LIBZIPPP_WITH_ENCRYPTION
+    if (isEncrypted() && zip_file_set_encryption(zipHandle,result,encryptionMethod,nullptr)!=0) { return false; } //unable to encrypt
+#endif
+    return true;
+}
+
+int ZipArchive::addDirectory(const string& root, const string& prefix, const std::function<bool(const string&)>& filter, libzippp_uint32 nbThreads) const {
+    if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+    if (mode==ReadOnly) { return LIBZIPPP_ERROR_NOT_ALLOWED; } //adding not allowed
+    if (root.empty()) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+    if (!prefix.empty() && !LIBZIPPP_ENTRY_IS_DIRECTORY(prefix)) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
+    if (nbThreads==0) { nbThreads = std::thread::hardware_concurrency(); }
+
+    //the tree is walked level by level, the items of a level being stat'ed concurrently
+    vector<Helper::DirectoryItem> files;
+    vector<string> directories;
+    vector<string> level(1, "");
+    while (!level.empty()) {
+        vector<Helper::DirectoryItem> items;
+        for(vector<string>::const_iterator it=level.begin() ; it!=level.end() ; ++it) {
+            vector<string> names;
+            if (!Helper::listDirectory(it->empty() ? root : root + "/" + *it, names)) {
+                return it->empty() ? LIBZIPPP_ERROR_INVALID_PARAMETER : LIBZIPPP_ERROR_FOPEN_FAILURE;
+            }
+            for(vector<string>::const_iterator nit=names.begin() ; nit!=names.end() ; ++nit) {
+                items.push_back(Helper::DirectoryItem(*it + *nit));
+            }
+        }
+        Helper::statItems(root, items, nbThreads);
+
+        level.clear();
+        for(vector<Helper::DirectoryItem>::iterator it=items.begin() ; it!=items.end() ; ++it) {
+            if (it->directory) {
+                it->path += LIBZIPPP_ENTRY_PATH_SEPARATOR;
+                if (filter && !filter(it->path)) { continue; } //the whole directory is skipped
+                directories.push_back(it->path);
+                level.push_back(it->path);
+            } else if (it->file && (!filter || filter(it->path))) {
+                files.push_back(*it);
             }
         }
+    }
 
-        /*
-         * Special case for moving a directory a/x to a/x/y to avoid to lose
-         * the a/x path in the archive.
-         */
-        bool newNameIsInsideCurrent = (newName.find(entry.getName())==0);
-        if (newNameIsInsideCurrent) {
-            bool dadded = addEntry(newName);
-            if (!dadded) { return LIBZIPPP_ERROR_UNKNOWN; }
+    //the entries are added in a stable order, which is also the order in which the files are read ahead
+    std::sort(directories.begin(), directories.end());
+    std::sort(files.begin(), files.end(), [](const Helper::DirectoryItem& a, const Helper::DirectoryItem& b) { return a.path<b.path; });
+
+    bool ownBatch = !batchOpen;
+    if (ownBatch) { beginBatch(); }
+
+    int counter = 0;
+    for(vector<string>::const_iterator it=directories.begin() ; counter>=0 && it!=directories.end() ; ++it) {
+        if (!addEntry(prefix + *it)) { counter = LIBZIPPP_ERROR_UNKNOWN; }
+    }
+
+    std::shared_ptr<ZipFilePrefetcher> prefetcher = std::make_shared<ZipFilePrefetcher>(LIBZIPPP_DIRECTORY_READ_AHEAD_SIZE);
+    for(vector<Helper::DirectoryItem>::const_iterator it=files.begin() ; counter>=0 && it!=files.end() ; ++it) {
+        string entryName = prefix + it->path;
+        string::size_type lastSlash = entryName.rfind(LIBZIPPP_ENTRY_PATH_SEPARATOR);
+        if (lastSlash!=string::npos && !addEntry(entryName.substr(0, lastSlash+1))) { //creates the needed parent directories
+            counter = LIBZIPPP_ERROR_UNKNOWN;
+            break;
         }
 
-        return counter;
+        //the files compressed by the pool are read by their job, hence they are not read ahead
+        string file = root + "/" + it->path;
+        std::shared_ptr<ZipCompressionJob> job;
+        if (isCompressionPoolEnabled() && it->size<=LIBZIPPP_POOL_MAX_ENTRY_SIZE) { job = std::make_shared<ZipCompressionJob>(file, it->mode); }
+        ZipPrefetchedFileSource* fileSource = new ZipPrefetchedFileSource(prefetcher, prefetcher->add(file, it->size, !job), it->size, it->mtime, it->mode);
+        zip_source* source = zip_source_function(zipHandle, ZipPrefetchedFileSource::callback, fileSource);
+        if (source==nullptr) {
+            delete fileSource;
+            counter = LIBZIPPP_ERROR_UNKNOWN;
+            break;
+        }
+
+        if (addFileSource(entryName, source, job, batchTime!=0 ? batchTime : it->mtime, it->mode)) { ++counter; }
+        else { counter = LIBZIPPP_ERROR_UNKNOWN; }
     }
+
+    if (ownBatch) { endBatch(); }
+    return counter;
 }
 
-int ZipArchive::renameEntry(const string& e, const string& newName) const {
-    ZipEntry entry = getEntry(e);
-    if (entry.isNull()) { return LIBZIPPP_ERROR_INVALID_PARAMETER; }
-    return renameEntry(entry, newName);
+bool ZipArchive::addStream(const string& entryName, istream& input) const {
+    return addGenerator(entryName, [&input](void* data, libzippp_uint64 length) -> libzippp_int64 {
+        input.read(static_cast<char*>(data), length);
+        return input.bad() ? -1 : (libzippp_int64)input.gcount();
+    });
 }
 
-bool ZipArchive::addFile(const string& entryName, const string& file) const {
+bool ZipArchive::addGenerator(const string& entryName, const std::function<libzippp_int64(void*,libzippp_uint64)>& generator) const {
     if (!isOpen()) { return false; }
     if (mode==ReadOnly) { return false; } //adding not allowed
     if (LIBZIPPP_ENTRY_IS_DIRECTORY(entryName)) { return false; }
@@ -793,39 +3578,39 @@ bool ZipArchive::addFile(const string& entryName, const string& file) const {
         if (!dadded) { return false; }
     }
 
-    const char* filepath = file.c_str();
-    zip_source* source = zip_source_file(zipHandle, filepath, 0, -1);
-    if (source!=nullptr) {
-        libzippp_int64 result = zip_file_add(zipHandle, entryName.c_str(), source, ZIP_FL_OVERWRITE);
-        if (result>=0) {
-            zip_file_set_mtime(zipHandle, result, time(nullptr), 0);
-            if (useArchiveCompressionMethod) {
-              zip_set_file_compression(zipHandle, result, compressionMethod, 0);
-            }
+    ZipGeneratorSource* generatorSource = new ZipGeneratorSource(generator);
+    zip_source* source = zip_source_function(zipHandle, ZipGeneratorSource::callback, generatorSource);
+    if (source==nullptr) {
+        delete generatorSource;
+        return false;
+    }
+
+    libzippp_int64 result = zip_file_add(zipHandle, entryName.c_str(), source, ZIP_FL_OVERWRITE);
+    if (result<0) {
+        zip_source_free(source); //deletes the generator source
+        return false;
+    }
+
+    indexEntry(result);
+    uncacheEntry(result); //overwritten entry
+    releasePendingData(result);
+    scheduleCompression(result, nullptr); //compressed by libzip while the data is generated
+    appendable = false; //the data couldn't be generated again if the append commit failed
+    zip_file_set_mtime(zipHandle, result, addedEntryTime(), 0);
+    if (useArchiveCompressionMethod) {
+      zip_set_file_compression(zipHandle, result, compressionMethod, 0);
+    }
 #ifdef LIBZIPPP_WITH_ENCRYPTION
-            if (isEncrypted()) {
-                if (zip_file_set_encryption(zipHandle,result,encryptionMethod,nullptr)!=0) { //unable to encrypt
-                    zip_source_free(source);
-                } else {
-                    return true;
-                }
-            } else {
-                return true;
-            }
-#else
-            return true;
+    if (isEncrypted() && zip_file_set_encryption(zipHandle,result,encryptionMethod,nullptr)!=0) { return false; } //unable to encrypt
 #endif
-        } else {
-            //unable to add the file
-            zip_source_free(source);
-        }
-    } else {
-        //unable to create the zip_source
-    }
-    return false;
+    return true;
 }
 
 bool ZipArchive::addData(const string& entryName, const void* data, libzippp_uint64 length, bool freeData) const {
+    return addOwnedData(entryName, nullptr, data, length, freeData);
+}
+
+bool ZipArchive::addOwnedData(const string& entryName, const std::shared_ptr<void>& owner, const void* data, libzippp_uint64 length, bool freeData) const {
     if (!isOpen()) { return false; }
     if (mode==ReadOnly) { return false; } //adding not allowed
     if (LIBZIPPP_ENTRY_IS_DIRECTORY(entryName)) { return false; }
@@ -837,11 +3622,40 @@ bool ZipArchive::addData(const string& entryName, const void* data, libzippp_uin
         if (!dadded) { return false; }
     }
 
-    zip_source* source = zip_source_buffer(zipHandle, data, length, freeData);
+    std::shared_ptr<ZipCompressionJob> job;
+    zip_source* source = nullptr;
+    bool spilled = isOverPendingDataLimit(length);
+    if (spilled) {
+        //the data is moved to a temporary file, compressed by libzip when the archive is written
+        FILE* file = Helper::spillData(spillDirectory, data, length);
+        if (freeData) { ::free(const_cast<void*>(data)); }
+        if (file==nullptr) { return false; }
+        source = zip_source_filep(zipHandle, file, 0, -1);
+        if (source==nullptr) { fclose(file); }
+    } else {
+        //when compressed by the pool, the data is owned by the job until the entry is written
+        if (isCompressionPoolEnabled() && length<=LIBZIPPP_POOL_MAX_ENTRY_SIZE) {
+            job = std::make_shared<ZipCompressionJob>(data, length, freeData);
+            job->owner = owner;
+        }
+        source = zip_source_buffer(zipHandle, data, length, job ? 0 : freeData);
+    }
+
     if (source!=nullptr) {
         libzippp_int64 result = zip_file_add(zipHandle, entryName.c_str(), source, ZIP_FL_OVERWRITE);
         if (result>=0) {
-            zip_file_set_mtime(zipHandle, result, time(nullptr), 0);
+            indexEntry(result);
+            uncacheEntry(result); //overwritten entry
+            releasePendingData(result);
+            scheduleCompression(result, job);
+            trackAddedEntry(result, useArchiveCompressionMethod ? compressionMethod : (libzippp_uint16)ZIP_CM_DEFAULT);
+            if (!spilled) { //otherwise the data has been copied in a temporary file
+                PendingData& pending = pendingData[result];
+                pending.size = length;
+                pending.owner = owner;
+                pendingDataSize += length;
+            }
+            zip_file_set_mtime(zipHandle, result, addedEntryTime(), 0);
             if (useArchiveCompressionMethod) {
               zip_set_file_compression(zipHandle, result, compressionMethod, 0);
             }
@@ -868,28 +3682,437 @@ bool ZipArchive::addData(const string& entryName, const void* data, libzippp_uin
     return false;
 }
 
-bool ZipArchive::addData(const std::string& entryName, const std::basic_string<libzippp_uint8> data) const {
-    return addData(entryName, data.data(), data.size(), false);
+bool ZipArchive::addData(const std::string& entryName, std::basic_string<libzippp_uint8> data) const {
+    //the argument is a copy which would be destroyed before the archive is written
+    std::shared_ptr<std::basic_string<libzippp_uint8> > owner = std::make_shared<std::basic_string<libzippp_uint8> >(std::move(data));
+    return addOwnedData(entryName, owner, owner->data(), owner->size(), false);
+}
+
+bool ZipArchive::addData(const std::string& entryName, vector<libzippp_uint8>&& data) const {
+    std::shared_ptr<vector<libzippp_uint8> > owner = std::make_shared<vector<libzippp_uint8> >(std::move(data));
+    return addOwnedData(entryName, owner, owner->data(), owner->size(), false);
+}
+
+bool ZipArchive::addData(const std::string& entryName, string&& data) const {
+    std::shared_ptr<string> owner = std::make_shared<string>(std::move(data));
+    return addOwnedData(entryName, owner, owner->data(), owner->size(), false);
+}
+
+bool ZipArchive::addData(const std::string& entryName, std::unique_ptr<libzippp_uint8[]> data, libzippp_uint64 length) const {
+    const libzippp_uint8* buffer = data.get();
+    std::shared_ptr<libzippp_uint8> owner(data.release(), std::default_delete<libzippp_uint8[]>());
+    return addOwnedData(entryName, owner, buffer, length, false);
+}
+
+void ZipArchive::releasePendingData(libzippp_uint64 index) const {
+    //the source of an overwritten or deleted entry has been freed by libzip, hence its data is not needed anymore
+    std::map<libzippp_uint64, PendingData>::iterator it = pendingData.find(index);
+    if (it==pendingData.end()) { return; }
+    pendingDataSize -= it->second.size;
+    pendingData.erase(it);
+}
+
+bool ZipArchive::isOverPendingDataLimit(libzippp_uint64 length) const {
+    return pendingDataLimit>0 && getPendingDataSize()+length>pendingDataLimit;
+}
+
+libzippp_uint64 ZipArchive::getPendingDataSize(void) const {
+    //the data compressed by the eager compression is held until the archive is closed
+    if (eagerCompressionEnabled && compressionPool!=nullptr) { return pendingDataSize+compressionPool->getReadySize(); }
+    return pendingDataSize;
+}
+
+time_t ZipArchive::addedEntryTime(void) const {
+    return batchOpen && batchTime!=0 ? batchTime : time(nullptr);
+}
+
+void ZipArchive::beginBatch(time_t timestamp) const {
+    batchOpen = true;
+    batchTime = timestamp;
+    batchDirectories.clear();
+}
+
+void ZipArchive::endBatch(void) const {
+    batchOpen = false;
+    batchTime = 0;
+    batchDirectories.clear();
 }
 
 bool ZipArchive::addEntry(const string& entryName) const {
     if (!isOpen()) { return false; }
     if (mode==ReadOnly) { return false; } //adding not allowed
     if (!LIBZIPPP_ENTRY_IS_DIRECTORY(entryName)) { return false; }
+    if (batchOpen && batchDirectories.count(entryName)>0) { return true; } //the whole hierarchy already exists
 
     string::size_type nextSlash = entryName.find(LIBZIPPP_ENTRY_PATH_SEPARATOR);
     while (nextSlash!=string::npos) {
         string pathToCreate = entryName.substr(0, nextSlash+1);
-        if (!hasEntry(pathToCreate)) {
+        bool known = batchOpen && batchDirectories.count(pathToCreate)>0;
+        if (!known && !hasEntry(pathToCreate)) {
             libzippp_int64 result = zip_dir_add(zipHandle, pathToCreate.c_str(), ZIP_FL_ENC_GUESS);
             if (result==-1) { return false; }
+            indexEntry(result);
+            trackAddedEntry(result, ZIP_CM_STORE);
+            if (batchOpen && batchTime!=0) { zip_file_set_mtime(zipHandle, result, batchTime, 0); }
         }
+        if (batchOpen && !known) { batchDirectories.insert(pathToCreate); }
         nextSlash = entryName.find(LIBZIPPP_ENTRY_PATH_SEPARATOR, nextSlash+1);
     }
 
     return true;
 }
 
+void ZipArchive::setEntryCacheSize(libzippp_uint64 maxSize) {
+    entryCacheSize = maxSize;
+    evictCachedEntries(maxSize);
+}
+
+void ZipArchive::clearEntryCache(void) {
+    evictCachedEntries(0);
+    entryCacheHits = 0;
+    entryCacheMisses = 0;
+}
+
+libzippp_uint64 ZipArchive::cacheKey(libzippp_uint64 index, State state) const {
+    //in ReadOnly mode, the Current state is the Original one
+    bool original = state==Original || mode==ReadOnly;
+    return index*2+(original ? 1 : 0);
+}
+
+std::shared_ptr<const vector<char> > ZipArchive::findCachedEntry(const ZipEntry& entry, State state, bool countMiss) const {
+    std::unordered_map<libzippp_uint64, std::list<CachedEntry>::iterator>::const_iterator it = entryCacheKeys.find(cacheKey(entry.getIndex(), state));
+    if (it==entryCacheKeys.end() || it->second->data->size()!=entry.getSize()) {
+        if (countMiss) { ++entryCacheMisses; }
+        return std::shared_ptr<const vector<char> >();
+    }
+
+    ++entryCacheHits;
+    entryCache.splice(entryCache.begin(), entryCache, it->second); //most recently used
+    return it->second->data;
+}
+
+void ZipArchive::cacheEntry(const ZipEntry& entry, State state, const void* data) const {
+    libzippp_uint64 size = entry.getSize();
+    if (size==0 || size>entryCacheSize) { return; } //nothing to save or would evict everything
+
+    libzippp_uint64 key = cacheKey(entry.getIndex(), state);
+    std::unordered_map<libzippp_uint64, std::list<CachedEntry>::iterator>::iterator it = entryCacheKeys.find(key);
+    if (it!=entryCacheKeys.end()) { //outdated content
+        entryCacheUsage -= it->second->data->size();
+        entryCache.erase(it->second);
+        entryCacheKeys.erase(it);
+    }
+    evictCachedEntries(entryCacheSize-size);
+
+    const char* bytes = static_cast<const char*>(data);
+    CachedEntry cached;
+    cached.key = key;
+    cached.data = std::make_shared<const vector<char> >(bytes, bytes+size);
+    entryCache.push_front(cached);
+    entryCacheKeys[key] = entryCache.begin();
+    entryCacheUsage += size;
+}
+
+void ZipArchive::uncacheEntry(libzippp_uint64 index) const {
+    std::unordered_map<libzippp_uint64, std::list<CachedEntry>::iterator>::iterator it = entryCacheKeys.find(cacheKey(index, Current));
+    if (it==entryCacheKeys.end()) { return; }
+
+    entryCacheUsage -= it->second->data->size();
+    entryCache.erase(it->second);
+    entryCacheKeys.erase(it);
+}
+
+void ZipArchive::evictCachedEntries(libzippp_uint64 maxUsage) const {
+    while (entryCacheUsage>maxUsage && !entryCache.empty()) {
+        const CachedEntry& leastRecent = entryCache.back();
+        entryCacheUsage -= leastRecent.data->size();
+        entryCacheKeys.erase(leastRecent.key);
+        entryCache.pop_back();
+    }
+}
+
+bool ZipArchive::isCompressionPoolEnabled(void) const {
+    if (compressionThreads==0 && !eagerCompressionEnabled) { return false; }
+    if (!useArchiveCompressionMethod) { return true; }
+    return compressionMethod==(libzippp_uint16)ZIP_CM_DEFAULT || compressionMethod==ZIP_CM_DEFLATE;
+}
+
+void ZipArchive::scheduleCompression(libzippp_uint64 index, const std::shared_ptr<ZipCompressionJob>& job) const {
+    std::map<libzippp_uint64, std::shared_ptr<ZipCompressionJob> >::iterator previous = compressionJobs.find(index);
+    if (previous!=compressionJobs.end()) { //replaced or deleted entry
+        if (compressionPool!=nullptr) { compressionPool->cancel(previous->second); }
+        compressionJobs.erase(previous);
+    }
+    if (!job) { return; }
+
+    compressionJobs[index] = job;
+    if (eagerCompressionEnabled) {
+        //none of the compressed entries is written before close, hence the workers stop once they hold too much
+        //data and the next entries are compressed while the archive is written
+        if (compressionPool==nullptr) {
+            libzippp_uint64 maxReadySize = pendingDataLimit>0 ? pendingDataLimit : LIBZIPPP_EAGER_COMPRESSION_MAX_SIZE;
+            compressionPool = new ZipCompressionPool(compressionThreads>0 ? compressionThreads : 1, 0, maxReadySize);
+        }
+        compressionPool->submit(job);
+    }
+}
+
+void ZipArchive::submitCompressionJobs(void) {
+    if (compressionJobs.empty()) { return; }
+    if (compressionPool==nullptr) { compressionPool = new ZipCompressionPool(compressionThreads, 2*compressionThreads, 0); }
+
+    //the sources are replaced in the order of the entries, which is the order in which zip_close writes them
+    //(the entries already submitted when added are not submitted twice)
+    std::map<libzippp_uint64, std::shared_ptr<ZipCompressionJob> >::const_iterator it;
+    for(it=compressionJobs.begin() ; it!=compressionJobs.end() ; ++it) {
+        ZipCompressedSource* context = new ZipCompressedSource(compressionPool, it->second);
+        zip_source* source = zip_source_function(zipHandle, ZipCompressedSource::callback, context);
+        if (source==nullptr) { //libzip compresses the entry itself
+            delete context;
+            continue;
+        }
+        if (zip_file_replace(zipHandle, it->first, source, 0)!=0) {
+            zip_source_free(source);
+            continue;
+        }
+        compressionPool->submit(it->second);
+    }
+    compressionJobs.clear();
+}
+
+void ZipArchive::trackAddedEntry(libzippp_uint64 index, libzippp_uint16 compMethod) const {
+    if (!appendable) { return; }
+    if ((libzippp_int64)index<zip_get_num_entries(zipHandle, LIBZIPPP_ORIGINAL_STATE_FLAGS)) { appendable = false; } //overwritten entry
+    if (compMethod!=ZIP_CM_STORE && compMethod!=ZIP_CM_DEFLATE && compMethod!=(libzippp_uint16)ZIP_CM_DEFAULT) { appendable = false; }
+    addedEntries[index] = compMethod;
+}
+
+void ZipArchive::trackChange(libzippp_uint64 index) const {
+    if (addedEntries.find(index)==addedEntries.end()) { appendable = false; } //an existing entry has been modified
+}
+
+bool ZipArchive::isAppendCommitPossible(void) const {
+    if (!appendCommitEnabled || !appendable || mode!=Write) { return false; }
+    if (zipSource!=nullptr || path.empty()) { return false; } //not open from a file
+    if (isEncrypted() || addedEntries.empty()) { return false; }
+    return zip_get_num_entries(zipHandle, LIBZIPPP_ORIGINAL_STATE_FLAGS)>0; //the archive exists
+}
+
+bool ZipArchive::commitAppend(void) {
+    libzippp_uint64 nbOriginal = (libzippp_uint64)zip_get_num_entries(zipHandle, LIBZIPPP_ORIGINAL_STATE_FLAGS);
+
+    //the current end of the file (central directory and end records) is kept to restore it if the append fails
+    libzippp_uint64 length = 0;
+    libzippp_uint64 cdOffset = 0;
+    libzippp_uint64 cdSize = 0;
+    libzippp_uint64 nbEntries = 0;
+    int systemError = 0;
+    vector<libzippp_uint8> tail;
+    void* mapped = Helper::mapFile(path, &length, &systemError);
+    if (mapped==nullptr) { return false; }
+    const libzippp_uint8* data = static_cast<const libzippp_uint8*>(mapped);
+    if (Helper::locateCentralDirectory(data, length, &cdOffset, &cdSize, &nbEntries)) { tail.assign(data+cdOffset, data+length); }
+    Helper::unmapFile(mapped, length);
+    if (tail.empty() || nbEntries!=nbOriginal) { return false; }
+
+    int commentLength = 0;
+    const char* comment = zip_get_archive_comment(zipHandle, &commentLength, LIBZIPPP_ORIGINAL_STATE_FLAGS);
+    if (comment==nullptr) { commentLength = 0; }
+
+    fstream output(path.c_str(), ios::in | ios::out | ios::binary);
+    if (!output.seekp(cdOffset)) { return false; }
+
+    //the entries are compressed by the pool in the order in which they are written
+    if (!compressionJobs.empty()) {
+        if (compressionPool==nullptr) { compressionPool = new ZipCompressionPool(compressionThreads, 2*compressionThreads, 0); }
+        std::map<libzippp_uint64, std::shared_ptr<ZipCompressionJob> >::const_iterator jit;
+        for(jit=compressionJobs.begin() ; jit!=compressionJobs.end() ; ++jit) { compressionPool->submit(jit->second); }
+    }
+
+    //the new local entries overwrite the central directory, which is written again followed by the new records
+    vector<libzippp_uint8> centralDirectory(tail.begin(), tail.begin()+cdSize);
+    libzippp_uint64 offset = cdOffset;
+    bool success = true;
+    std::map<libzippp_uint64, libzippp_uint16>::const_iterator it;
+    for(it=addedEntries.begin() ; success && it!=addedEntries.end() ; ++it) {
+        success = appendEntry(output, it->first, it->second, &offset, centralDirectory);
+    }
+
+    vector<libzippp_uint8> end;
+    Helper::writeEndRecords(end, nbOriginal+addedEntries.size(), offset, centralDirectory.size(), comment, (libzippp_uint16)commentLength);
+
+    if (success) {
+        success = output.write(reinterpret_cast<const char*>(centralDirectory.data()), centralDirectory.size())
+               && output.write(reinterpret_cast<const char*>(end.data()), end.size())
+               && output.flush()
+               && offset+centralDirectory.size()+end.size()>=length; //no leftover of the previous end of the file
+    }
+
+    if (!success) {
+        Helper::callErrorHandlingCallbackFunc("unable to append the entries: %s\n", ZIP_ER_WRITE, 0, errorHandlingCallback);
+
+        //the previous end of the file is written back and the appended data cut, then libzip commits the archive
+        //instead (it only reads the original entries, which are located before the central directory)
+        output.clear();
+        bool restored = output.seekp(cdOffset)
+                     && output.write(reinterpret_cast<const char*>(tail.data()), tail.size())
+                     && output.flush();
+        output.close();
+        if (!restored || !Helper::truncateFile(path, length, &systemError)) {
+            Helper::callErrorHandlingCallbackFunc("unable to restore the archive: %s\n", ZIP_ER_WRITE, systemError, errorHandlingCallback);
+        }
+    }
+    return success;
+}
+
+bool ZipArchive::appendEntry(ostream& output, libzippp_uint64 index, libzippp_uint16 compMethod, libzippp_uint64* offset, vector<libzippp_uint8>& centralDirectory) const {
+    const char* name = zip_get_name(zipHandle, index, ZIP_FL_ENC_RAW);
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    if (name==nullptr || zip_stat_index(zipHandle, index, 0, &stat)!=0) { return false; }
+
+    zip_uint8_t opsys = 0;
+    zip_uint32_t attributes = 0;
+    if (zip_file_get_external_attributes(zipHandle, index, 0, &opsys, &attributes)!=0) { return false; }
+
+    string entryName(name);
+    libzippp_uint16 flags = Helper::isUtf8Name(entryName) ? 0x0800 : 0; //the names are added as UTF-8
+    bool store = compMethod==ZIP_CM_STORE;
+    libzippp_uint16 method = store ? ZIP_CM_STORE : ZIP_CM_DEFLATE;
+
+    //the CRC and the sizes are written once the data has been written
+    bool zip64 = (stat.valid & ZIP_STAT_SIZE)==0 || stat.size>=LIBZIPPP_ZIP64_THRESHOLD;
+    vector<libzippp_uint8> header;
+    Helper::writeLocalHeader(header, entryName, zip64, flags, method, stat.mtime);
+    if (!output.write(reinterpret_cast<const char*>(header.data()), header.size())) { return false; }
+
+    libzippp_uint64 size = 0;
+    libzippp_uint64 compSize = 0;
+    libzippp_uint32 crc = 0;
+    bool success;
+    std::function<bool(const void*,libzippp_uint64)> writeFunc = [&output, &compSize](const void* data, libzippp_uint64 length) {
+        compSize += length;
+        return !output.write(static_cast<const char*>(data), length).fail();
+    };
+    std::map<libzippp_uint64, std::shared_ptr<ZipCompressionJob> >::const_iterator job = compressionJobs.find(index);
+    if (job!=compressionJobs.end() && !store) {
+        success = compressionPool->wait(job->second) && writeFunc(job->second->compressed.data(), job->second->compressed.size());
+        size = job->second->size;
+        crc = job->second->crc;
+        compressionPool->release(job->second);
+    } else {
+        struct zip_file* zipFile = zip_fopen_index(zipHandle, index, 0);
+        if (zipFile==nullptr) { return false; }
+        success = Helper::deflateData([zipFile](void* buffer, libzippp_uint64 length) -> libzippp_int64 {
+            return zip_fread(zipFile, buffer, length);
+        }, writeFunc, store, &size, &crc);
+        zip_fclose(zipFile);
+    }
+    if (!success) { return false; }
+    if (!zip64 && (size>=0xFFFFFFFF || compSize>=0xFFFFFFFF)) { return false; }
+
+    vector<libzippp_uint8> sizes;
+    Helper::writeUInt32(sizes, crc);
+    Helper::writeUInt32(sizes, zip64 ? 0xFFFFFFFF : (libzippp_uint32)compSize);
+    Helper::writeUInt32(sizes, zip64 ? 0xFFFFFFFF : (libzippp_uint32)size);
+    if (zip64) {
+        Helper::writeUInt64(sizes, size);
+        Helper::writeUInt64(sizes, compSize);
+    }
+    libzippp_uint64 dataEnd = *offset+header.size()+compSize;
+    if (!output.seekp(*offset+14) || !output.write(reinterpret_cast<const char*>(sizes.data()), 12)) { return false; }
+    if (zip64 && (!output.seekp(*offset+LIBZIPPP_LOCAL_HEADER_SIZE+entryName.size()+4) || !output.write(reinterpret_cast<const char*>(sizes.data()+12), 16))) { return false; }
+    if (!output.seekp(dataEnd)) { return false; }
+
+    Helper::writeCentralRecord(centralDirectory, entryName, opsys, zip64, flags, method, stat.mtime, crc, compSize, size, attributes, *offset);
+    *offset = dataEnd;
+    return true;
+}
+
+void ZipArchive::setEntryIndexEnabled(bool enabled) {
+    entryIndexEnabled = enabled;
+    if (isOpen() && enabled) { buildEntryIndex(); }
+    else { entryIndex.clear(); }
+}
+
+void ZipArchive::buildEntryIndex(void) const {
+    entryIndex.clear();
+
+    libzippp_int64 nbEntries = zip_get_num_entries(zipHandle, 0);
+    entryIndex.reserve(nbEntries);
+    for(libzippp_int64 i=0 ; i<nbEntries ; ++i) {
+        const char* name = zip_get_name(zipHandle, i, ZIP_FL_ENC_GUESS);
+        if (name!=nullptr) { //deleted entries don't have any name
+            entryIndex.insert(std::make_pair(Helper::hashEntryName(name, strlen(name)), (libzippp_uint64)i));
+        }
+    }
+}
+
+void ZipArchive::buildPathIndex(void) const {
+    pathIndex.clear();
+
+    libzippp_int64 nbEntries = zip_get_num_entries(zipHandle, 0);
+    for(libzippp_int64 i=0 ; i<nbEntries ; ++i) {
+        const char* name = zip_get_name(zipHandle, i, ZIP_FL_ENC_GUESS);
+        if (name!=nullptr) { //deleted entries don't have any name
+            pathIndex.insert(pathIndex.end(), std::make_pair(string(name), (libzippp_uint64)i));
+        }
+    }
+    pathIndexLoaded = true;
+}
+
+void ZipArchive::indexEntry(libzippp_uint64 index) const {
+    if (!entryIndexEnabled && !pathIndexLoaded) { return; }
+
+    const char* name = zip_get_name(zipHandle, index, ZIP_FL_ENC_GUESS);
+    if (name==nullptr) { return; }
+
+    if (pathIndexLoaded) {
+        typedef std::multimap<string, libzippp_uint64>::const_iterator PathIterator;
+        std::pair<PathIterator, PathIterator> paths = pathIndex.equal_range(name);
+        PathIterator pit = paths.first;
+        while (pit!=paths.second && pit->second!=index) { ++pit; }
+        if (pit==paths.second) { pathIndex.insert(std::make_pair(string(name), index)); } //not overwritten
+    }
+    if (!entryIndexEnabled) { return; }
+
+    libzippp_uint64 hash = Helper::hashEntryName(name, strlen(name));
+    typedef std::unordered_multimap<libzippp_uint64, libzippp_uint64>::const_iterator IndexIterator;
+    std::pair<IndexIterator, IndexIterator> range = entryIndex.equal_range(hash);
+    for(IndexIterator it=range.first ; it!=range.second ; ++it) {
+        if (it->second==index) { return; } //already indexed (overwritten entry)
+    }
+    entryIndex.insert(std::make_pair(hash, index));
+}
+
+void ZipArchive::unindexEntry(libzippp_uint64 index) const {
+    if (!entryIndexEnabled && !pathIndexLoaded) { return; }
+
+    const char* name = zip_get_name(zipHandle, index, ZIP_FL_ENC_GUESS);
+    if (name==nullptr) { return; }
+
+    if (pathIndexLoaded) {
+        typedef std::multimap<string, libzippp_uint64>::iterator PathIterator;
+        std::pair<PathIterator, PathIterator> paths = pathIndex.equal_range(name);
+        for(PathIterator pit=paths.first ; pit!=paths.second ; ++pit) {
+            if (pit->second==index) {
+                pathIndex.erase(pit);
+                break;
+            }
+        }
+    }
+    if (!entryIndexEnabled) { return; }
+
+    typedef std::unordered_multimap<libzippp_uint64, libzippp_uint64>::iterator IndexIterator;
+    std::pair<IndexIterator, IndexIterator> range = entryIndex.equal_range(Helper::hashEntryName(name, strlen(name)));
+    for(IndexIterator it=range.first ; it!=range.second ; ++it) {
+        if (it->second==index) {
+            entryIndex.erase(it);
+            return;
+        }
+    }
+}
+
 void ZipArchive::removeProgressListener(ZipProgressListener* listener) {
     for(vector<ZipProgressListener*>::const_iterator it=listeners.begin() ; it!=listeners.end() ; ++it) {
         ZipProgressListener* l = *it;
@@ -920,89 +4143,120 @@ int ZipArchive::readEntry(const ZipEntry& zipEntry, std::function<bool(const voi
     if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
     if (zipEntry.zipFile!=this) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
 
-    int iRes = LIBZIPPP_OK;
-    int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
-    struct zip_file* zipFile = zip_fopen_index(zipHandle, zipEntry.getIndex(), flag);
-    if (zipFile) {
-        libzippp_uint64 maxSize = zipEntry.getSize();
-        if (!chunksize) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; } // use the default chunk size (512K) if not specified by the user
-
-        if (maxSize<chunksize) {
-            char* data = NEW_CHAR_ARRAY(maxSize)
-            if (data!=nullptr) {
-                libzippp_int64 result = zip_fread(zipFile, data, maxSize);
-                if (result>=0) {
-                    if (result != static_cast<libzippp_int64>(maxSize)) {
-                        iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
-                    } else if (!writeFunc(data, maxSize)) {
-                        iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
-                    }
-                } else {
-                    iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
-                }
-                delete[] data;
-            } else {
-                iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
-            }
-        } else {
-            libzippp_uint64 uWrittenBytes = 0;
-            libzippp_int64 result = 0;
-            char* data = NEW_CHAR_ARRAY(chunksize)
-            if (data!=nullptr) {
-                string::size_type nbChunks = maxSize/chunksize;
-                for (libzippp_uint32 uiChunk=0 ; uiChunk<nbChunks ; ++uiChunk) {
-                    result = zip_fread(zipFile, data, chunksize);
-                    if (result>=0) {
-                        if (result!=static_cast<libzippp_int64>(chunksize)) {
-                            iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
-                            break;
-                        } else {
-                            if (!writeFunc(data, chunksize)) {
-                                iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
-                                break;
-                            }
-                            uWrittenBytes += result;
-                        }
-                    } else {
-                        iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
-                        break;
-                    }
-                }
-                delete[] data;
-            } else {
-                iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
+    //the entry isn't cached by this read, hence a miss would never turn into a hit
+    if (entryCacheSize>0) {
+        std::shared_ptr<const vector<char> > cached = findCachedEntry(zipEntry, state, false);
+        if (cached) {
+            if (!chunksize) { chunksize = LIBZIPPP_DEFAULT_CHUNK_SIZE; }
+            for(libzippp_uint64 offset=0 ; offset<cached->size() ; offset+=chunksize) {
+                libzippp_uint64 length = cached->size()-offset<chunksize ? cached->size()-offset : chunksize;
+                if (!writeFunc(cached->data()+offset, length)) { return LIBZIPPP_ERROR_OWRITE_FAILURE; }
             }
+            return LIBZIPPP_OK;
+        }
+    }
 
-            libzippp_uint64 leftOver = maxSize%chunksize;
-            if (iRes==0 && leftOver>0) {
-                char* data = NEW_CHAR_ARRAY(leftOver);
-                if (data!=nullptr) {
-                    result = zip_fread(zipFile, data, leftOver);
-                    if (result>=0) {
-                        if (result!=static_cast<libzippp_int64>(leftOver)) {
-                            iRes = LIBZIPPP_ERROR_OWRITE_INDEX_FAILURE;
-                        } else {
-                            if (!writeFunc(data, leftOver)) {
-                                iRes = LIBZIPPP_ERROR_OWRITE_FAILURE;
-                            } else {
-                                uWrittenBytes += result;
-                                if (uWrittenBytes!=maxSize) {
-                                    iRes = LIBZIPPP_ERROR_UNKNOWN; // shouldn't occur but let's be careful
-                                }
-                            }
-                        }
-                    } else {
-                        iRes = LIBZIPPP_ERROR_FREAD_FAILURE;
-                    }
-                } else {
-                    iRes = LIBZIPPP_ERROR_MEMORY_ALLOCATION;
-                }
-                delete[] data;
+    int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+    if (readAheadEnabled) { return Helper::readEntryChunksAsync(zipHandle, zipEntry, flag, writeFunc, chunksize); }
+    return Helper::readEntryChunks(zipHandle, zipEntry, flag, writeFunc, chunksize);
+}
+
+zip* ZipArchive::openReadHandle(void) const {
+    zip* handle = nullptr;
+    if (originalData!=nullptr) {
+        zip_error_t error;
+        zip_error_init(&error);
+        zip_source* source = zip_source_buffer_create(originalData, originalDataLength, 0, &error);
+        if (source!=nullptr) {
+            handle = zip_open_from_source(source, ZIP_RDONLY, &error);
+            if (handle==nullptr) { zip_source_free(source); }
+        }
+        zip_error_fini(&error);
+    } else if (!path.empty()) {
+        int errorFlag = 0;
+        handle = zip_open(path.c_str(), ZIP_RDONLY, &errorFlag);
+    }
+
+#ifdef LIBZIPPP_WITH_ENCRYPTION
+    if (handle!=nullptr && isEncrypted()) {
+        if (zip_set_default_password(handle, password.c_str())!=0) {
+            zip_discard(handle);
+            handle = nullptr;
+        }
+    }
+#endif
+
+    return handle;
+}
+
+int ZipArchive::extractEntries(const vector<ZipEntry>& entries, std::function<bool(const ZipEntry&,const void*,libzippp_uint64)> writeFunc, libzippp_uint32 nbThreads, State state, libzippp_uint64 chunksize) const {
+    if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+    for(vector<ZipEntry>::const_iterator it=entries.begin() ; it!=entries.end() ; ++it) {
+        if (it->zipFile!=this) { return LIBZIPPP_ERROR_INVALID_ENTRY; }
+    }
+
+    if (nbThreads==0) { nbThreads = std::thread::hardware_concurrency(); }
+    if (nbThreads>entries.size()) { nbThreads = (libzippp_uint32)entries.size(); }
+
+    //a libzip handle can't be shared between threads, hence each worker opens its own
+    //one on the same data, which only reflects the Original state of the archive
+    vector<zip*> handles;
+    if (nbThreads>1 && (mode==ReadOnly || state==Original)) {
+        for(libzippp_uint32 i=0 ; i<nbThreads ; ++i) {
+            zip* handle = openReadHandle();
+            if (handle==nullptr) { break; }
+            handles.push_back(handle);
+        }
+    }
+
+    int flag = state==Original ? LIBZIPPP_ORIGINAL_STATE_FLAGS : ZIP_FL_ENC_GUESS;
+    std::atomic<size_t> nextEntry(0);
+    std::atomic<int> iRes(LIBZIPPP_OK);
+    std::mutex errorMutex;
+    std::exception_ptr error; //first exception thrown by writeFunc, rethrown once all the workers are done
+    auto worker = [&](zip* handle) {
+        size_t i;
+        while (iRes.load()==LIBZIPPP_OK && (i = nextEntry++)<entries.size()) {
+            const ZipEntry& entry = entries[i];
+            std::function<bool(const void*,libzippp_uint64)> entryFunc = [&writeFunc, &entry](const void* data, libzippp_uint64 size) { return writeFunc(entry, data, size); };
+            int result;
+            try {
+                result = Helper::readEntryChunks(handle, entry, flag, entryFunc, chunksize);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) { error = std::current_exception(); }
+                result = LIBZIPPP_ERROR_UNKNOWN; //stops the other workers
+            }
+            if (result!=LIBZIPPP_OK) {
+                int expected = LIBZIPPP_OK;
+                iRes.compare_exchange_strong(expected, result);
             }
         }
-        zip_fclose(zipFile);
+    };
+
+    if (handles.size()<=1) { //not enough handles to gain anything from the threads
+        for(vector<zip*>::const_iterator it=handles.begin() ; it!=handles.end() ; ++it) { zip_discard(*it); }
+        worker(zipHandle);
     } else {
-       iRes = LIBZIPPP_ERROR_FOPEN_FAILURE;
+        vector<std::thread> threads;
+        for(vector<zip*>::const_iterator it=handles.begin() ; it!=handles.end() ; ++it) {
+            threads.push_back(std::thread(worker, *it));
+        }
+        for(vector<std::thread>::iterator it=threads.begin() ; it!=threads.end() ; ++it) { it->join(); }
+        for(vector<zip*>::const_iterator it=handles.begin() ; it!=handles.end() ; ++it) { zip_discard(*it); }
+    }
+
+    if (error) { std::rethrow_exception(error); }
+    return iRes.load();
+}
+
+int ZipArchive::extractAll(std::function<bool(const ZipEntry&,const void*,libzippp_uint64)> writeFunc, libzippp_uint32 nbThreads, State state, libzippp_uint64 chunksize) const {
+    if (!isOpen()) { return LIBZIPPP_ERROR_NOT_OPEN; }
+
+    vector<ZipEntry> files;
+    ZipEntryRange entries = iterateEntries(state);
+    for(ZipEntryIterator it=entries.begin() ; it!=entries.end() ; ++it) {
+        if (it->isFile()) { files.push_back(*it); }
     }
-    return iRes;
+    return extractEntries(files, writeFunc, nbThreads, state, chunksize);
 }
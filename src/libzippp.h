@@ -39,17 +39,30 @@
 #include <cstdint>
 #endif
 #include <cstdio>
+#include <cstddef>
+#include <iterator>
+#include <istream>
+#include <ostream>
+#include <streambuf>
 #include <string>
 #include <vector>
 #include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 //defined in libzip
 struct zip;
+struct zip_file;
 struct zip_source;
+struct z_stream_s;
 
 #define LIBZIPPP_ENTRY_PATH_SEPARATOR '/'
 #define LIBZIPPP_ENTRY_IS_DIRECTORY(str) ((str).length()>0 && (str)[(str).length()-1]==LIBZIPPP_ENTRY_PATH_SEPARATOR)
 #define LIBZIPPP_DEFAULT_CHUNK_SIZE 524288
+#define LIBZIPPP_DEFAULT_CHECKPOINT_INTERVAL 1048576
 #define LIBZIPPP_DEFAULT_PROGRESSION_PRECISION 0.5
 
 //libzip documentation
@@ -118,7 +131,12 @@ typedef void ErrorHandlerCallback(const std::string& message,
 
 namespace libzippp {
     class ZipEntry;
+    class ZipEntryTable;
+    class ZipEntryRange;
     class ZipProgressListener;
+    class ZipInflateBackend;
+    class ZipCompressionPool;
+    struct ZipCompressionJob;
 
     /**
      * Compression algorithm to use.
@@ -248,7 +266,7 @@ namespace libzippp {
          * 
          * Use ZipArchive::free to delete the returned pointer.
          */
-        static ZipArchive* fromBuffer(const void* data, libzippp_uint32 size, bool checkConsistency=false, const std::string& password="", Encryption encryptionMethod=Encryption::None);
+        static ZipArchive* fromBuffer(const void* data, libzippp_uint64 size, bool checkConsistency=false, const std::string& password="", Encryption encryptionMethod=Encryption::None);
         
         /**
          * Creates a new ZipArchive from the specified data. The archive will
@@ -259,6 +277,7 @@ namespace libzippp {
          * 
          * If the mode is New or Write, then the data pointer will be updated when the ZipArchive is
          * closed and its new length will be available through the ZipArchive::getBufferLength method.
+         * The archive might exceed 4GB or 65535 entries, the Zip64 extensions being then used.
          * 
          * WARNING: do NOT use dynamicly allocated memory with the 'new' keyword as data, because since
          * the data array might be extended by realloc, it *might* not be compatible with C++ 'new' keyword.
@@ -266,7 +285,18 @@ namespace libzippp {
          * 
          * Use ZipArchive::free to delete the returned pointer.
          */
-        static ZipArchive* fromWritableBuffer(void** data, libzippp_uint32 size, OpenMode mode=Write, bool checkConsistency=false, const std::string& password="", Encryption encryptionMethod=Encryption::None);
+        static ZipArchive* fromWritableBuffer(void** data, libzippp_uint64 size, OpenMode mode=Write, bool checkConsistency=false, const std::string& password="", Encryption encryptionMethod=Encryption::None);
+        
+        /**
+         * Creates a new ZipArchive by mapping the specified file in memory. The archive will
+         * directly be open in ReadOnly mode and libzip will read the entries straight from the
+         * mapping, without any intermediate copy. If the file can't be mapped, if the archive
+         * fails to be open or if the consistency check fails, this method will return null.
+         * The mapping is released when the ZipArchive is closed.
+         * 
+         * Use ZipArchive::free to delete the returned pointer.
+         */
+        static ZipArchive* fromMappedFile(const std::string& zipPath, bool checkConsistency=false, const std::string& password="", Encryption encryptionMethod=Encryption::None);
         
         /**
          * Deletes a ZipArchive.
@@ -376,6 +406,47 @@ namespace libzippp {
          */
         std::vector<ZipEntry> getEntries(State state=Current) const;
         
+        /**
+         * Returns a range over the entries of the ZipArchive, usable in a range-based for loop. Unlike getEntries,
+         * each entry is read from libzip only when the iteration reaches it, hence stopping the loop early
+         * does not cost anything for the remaining entries. Only the entries whose index is between first
+         * (included) and last (excluded) are iterated. If last is negative, the iteration goes up to the last entry.
+         * If the state is Original, then iterates over the entries in the original archive, any change will not be considered.
+         * The zip file must be open otherwise an empty range will be returned.
+         * The range must not be used once the ZipArchive has been closed.
+         */
+        ZipEntryRange iterateEntries(State state=Current, libzippp_int64 first=0, libzippp_int64 last=-1) const;
+        
+        /**
+         * Returns a compact table with the metadata of all the entries of the ZipArchive. If the state is Original,
+         * then returns the entries in the original archive, any change will not be considered.
+         * Unlike getEntries, no ZipEntry is created: the names are packed in a single buffer and the other
+         * fields are stored in parallel arrays, which is much lighter for archives with a lot of entries.
+         * The zip file must be open otherwise an empty table will be returned.
+         */
+        ZipEntryTable getEntryTable(State state=Current) const;
+        
+        /**
+         * Returns the entries whose name starts with the specified prefix, sorted by name. For instance,
+         * the prefix "assets/textures/" returns the directory itself and all the entries it contains (recursively).
+         * In the Current state, the entries are found through a sorted index of the names that is built on the
+         * first call and then kept up to date, hence the whole archive doesn't need to be scanned again.
+         * If the state is Original, then the entries of the original archive are scanned.
+         * The zip file must be open otherwise an empty vector will be returned.
+         */
+        std::vector<ZipEntry> getEntriesWithPrefix(const std::string& prefix, State state=Current) const;
+        
+        /**
+         * Returns the entries whose name matches the specified pattern, sorted by name. In the pattern,
+         * '?' matches any single character but '/', '*' matches any sequence of characters without '/' and
+         * '**' matches any sequence of characters. For instance "*.png" only matches the png files at the root
+         * of the archive, while "**.png" matches all the png files, whatever their directory.
+         * The characters before the first wildcard are used to only consider the entries starting with them
+         * (see getEntriesWithPrefix).
+         * The zip file must be open otherwise an empty vector will be returned.
+         */
+        std::vector<ZipEntry> getEntriesMatching(const std::string& pattern, State state=Current) const;
+        
         /**
          * Returns true if an entry with the specified name exists. If no such entry exists,
          * then false will be returned. If a directory is searched, the name must end with a '/' !
@@ -383,6 +454,15 @@ namespace libzippp {
          */
         bool hasEntry(const std::string& name, bool excludeDirectories=false, bool caseSensitive=true, State state=Current) const;
         
+        /**
+         * Returns the index of the entry with the specified name, given as a pointer to its characters and
+         * its length (the name doesn't need to be null-terminated), or -1 if no such entry exists.
+         * If a directory is searched, the name must end with a '/' !
+         * The zip file must be open otherwise LIBZIPPP_ERROR_NOT_OPEN will be returned.
+         * The ZipEntry can then be retrieved through ZipArchive::getEntry(libzippp_int64, State).
+         */
+        libzippp_int64 locateEntry(const char* name, libzippp_uint64 length, bool excludeDirectories=false, bool caseSensitive=true, State state=Current) const;
+        
         /**
          * Returns the ZipEntry for the specified entry name. If no such entry exists,
          * then a null-ZiPEntry will be returned. If a directory is searched, the name
@@ -435,6 +515,38 @@ namespace libzippp {
          */
         void* readEntry(const std::string& zipEntry, bool asText=false, State state=Current, libzippp_uint64 size=0) const;
         
+        /**
+         * Reads the specified ZipEntry of the ZipArchive into the provided buffer, which can hold capacity bytes.
+         * If the entry is bigger than the buffer, only its first capacity bytes are read. Since no memory is allocated,
+         * the same buffer can be reused to read a lot of entries.
+         * Returns the number of bytes read or LIBZIPPP_ERROR_NOT_OPEN if the archive is not open, LIBZIPPP_ERROR_INVALID_ENTRY
+         * if the zipEntry doesn't belong to the archive, LIBZIPPP_ERROR_INVALID_PARAMETER if the buffer is null,
+         * LIBZIPPP_ERROR_FOPEN_FAILURE if zip_fopen_index() has failed and LIBZIPPP_ERROR_FREAD_FAILURE if zip_fread()
+         * didn't read the expected amount of data.
+         */
+        libzippp_int64 readEntryInto(const ZipEntry& zipEntry, void* buffer, libzippp_uint64 capacity, State state=Current) const;
+        
+        /**
+         * Reads the specified ZipEntry of the ZipArchive into the provided string or vector, which is resized in place to
+         * the size of the entry (or size if the latter is specified and smaller). Unlike ZipEntry::readAsText, there is
+         * no intermediate buffer and the memory already held by the output is reused when it is big enough.
+         * Returns LIBZIPPP_OK if the entry has been read or one of the error codes of readEntryInto(const ZipEntry&, void*,
+         * libzippp_uint64, State), in which case the output is cleared.
+         */
+        int readEntryInto(const ZipEntry& zipEntry, std::string& output, State state=Current, libzippp_uint64 size=0) const;
+        int readEntryInto(const ZipEntry& zipEntry, std::vector<libzippp_uint8>& output, State state=Current, libzippp_uint64 size=0) const;
+        
+        /**
+         * Returns a pointer to the content of the specified ZipEntry directly within the data the ZipArchive has been
+         * created from (ZipArchive::fromBuffer, ZipArchive::fromWritableBuffer or ZipArchive::fromMappedFile), without
+         * any allocation nor copy. The returned pointer is valid for zipEntry.getSize() bytes while the ZipArchive is open
+         * and must not be deleted.
+         * This is only possible for entries stored without compression (STORE) and without encryption. Since only the
+         * original data is available, the archive must be open in ReadOnly mode or the state must be Original.
+         * In all other cases, this method returns null and ZipArchive::readEntry must be used instead.
+         */
+        const void* readEntryView(const ZipEntry& zipEntry, State state=Current) const;
+        
         /**
          * Reads the specified ZipEntry of the ZipArchive and inserts its content in the provided reference to an already
          * opened std::ofstream, gradually, with chunks of size "chunksize" to reduce memory usage when dealing with big files.
@@ -463,6 +575,27 @@ namespace libzippp {
          */
         int readEntry(const ZipEntry& zipEntry, std::function<bool(const void*,libzippp_uint64)> output, State state=Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE) const;
 
+        /**
+         * Reads the specified entries of the ZipArchive concurrently on nbThreads worker threads and invokes the output
+         * function with their content, gradually, with chunks of size "chunksize" (see ZipArchive::readEntry).
+         * Each worker uses its own libzip handle open on the same file or buffer as this ZipArchive, hence the
+         * entries are read in parallel only when the archive is open in ReadOnly mode or when the state is Original.
+         * Otherwise (or if the archive has been created with ZipArchive::fromSource), the entries are read serially
+         * on the calling thread.
+         * The output function may be invoked concurrently from several threads, but all the chunks of a given entry
+         * are delivered in order by the same thread. If nbThreads is zero, the number of hardware threads is used.
+         * The method returns LIBZIPPP_OK if all the entries have been extracted, LIBZIPPP_ERROR_NOT_OPEN if the archive
+         * is not open, LIBZIPPP_ERROR_INVALID_ENTRY if one of the entries doesn't belong to the archive, or the first error
+         * code returned while reading an entry (see ZipArchive::readEntry). The extraction stops at the first error.
+         */
+        int extractEntries(const std::vector<ZipEntry>& entries, std::function<bool(const ZipEntry&,const void*,libzippp_uint64)> output, libzippp_uint32 nbThreads=0, State state=Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE) const;
+
+        /**
+         * Reads all the files (directories are skipped) of the ZipArchive concurrently.
+         * This method is a wrapper around ZipArchive::extractEntries(...).
+         */
+        int extractAll(std::function<bool(const ZipEntry&,const void*,libzippp_uint64)> output, libzippp_uint32 nbThreads=0, State state=Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE) const;
+
         /**
          * Deletes the specified entry from the zip file. If the entry is a folder, all its
          * subentries will be removed. This method returns the number of entries removed.
@@ -532,8 +665,49 @@ namespace libzippp {
          * If the entryName contains folders that don't exist in the archive, they will be automatically created.
          * If the entryName denotes a directory, this method returns false.
          * If the zip file is not open, this method returns false.
+         * The data is kept by the ZipArchive until it is closed.
+         */
+        bool addData(const std::string& entryName, std::basic_string<libzippp_uint8> data) const;
+
+        /**
+         * Adds the given data to the specified entry name in the archive, as the other addData methods.
+         * The ZipArchive takes the ownership of the data, without copying it, and releases it once the
+         * archive has been closed or discarded (or directly if the entry couldn't be added). Hence the
+         * caller doesn't have to keep the data alive until then.
          */
-        bool addData(const std::string& entryName, const std::basic_string<libzippp_uint8> data) const;
+        bool addData(const std::string& entryName, std::vector<libzippp_uint8>&& data) const;
+        bool addData(const std::string& entryName, std::string&& data) const;
+        bool addData(const std::string& entryName, std::unique_ptr<libzippp_uint8[]> data, libzippp_uint64 length) const;
+        
+        /**
+         * Adds an entry whose content is pulled from the given stream or generator while the archive is written
+         * by ZipArchive::close, so that large entries can be archived without being held in memory or written in
+         * a file first. The generator receives a buffer and its capacity and returns the number of bytes written in
+         * it, zero at the end of the data or a negative value if an error occurred (close then fails).
+         * The stream or the generator must remain valid until the archive is closed. The data is generated only once,
+         * hence the content of the entry can't be read before the archive has been closed.
+         * If the entryName contains folders that don't exist in the archive, they will be automatically created.
+         * If the entryName denotes a directory or if the zip file is not open, these methods return false.
+         */
+        bool addStream(const std::string& entryName, std::istream& input) const;
+        bool addGenerator(const std::string& entryName, const std::function<libzippp_int64(void*,libzippp_uint64)>& generator) const;
+
+        /**
+         * Adds all the files of the root directory and of its sub-directories to the archive, in a single batch (see
+         * ZipArchive::beginBatch). The entries are named with the path of the files relative to the root, using '/'
+         * as separator, and prefixed by the prefix (which must be empty or end with '/'). The directories are added
+         * as well, including the empty ones. If a filter is specified, it receives the relative path of each file and
+         * directory (ending with '/'): if it returns false, the file or the whole directory is skipped.
+         * The files are stat'ed concurrently on nbThreads threads (the number of hardware threads if zero) and the
+         * entries get their modification time, unless a timestamp has been given to the current batch. While the
+         * archive is written, the next files are read ahead by a background thread. The links to directories and
+         * the special files are skipped.
+         * This method returns the number of files added, LIBZIPPP_ERROR_NOT_OPEN if the archive is not open,
+         * LIBZIPPP_ERROR_NOT_ALLOWED if it is open in ReadOnly mode, LIBZIPPP_ERROR_INVALID_PARAMETER if the root
+         * can't be read or the prefix is invalid, LIBZIPPP_ERROR_FOPEN_FAILURE if a sub-directory can't be read (nothing
+         * is added then) or LIBZIPPP_ERROR_UNKNOWN if an entry couldn't be added (the previous ones remain).
+         */
+        int addDirectory(const std::string& root, const std::string& prefix="", const std::function<bool(const std::string&)>& filter=nullptr, libzippp_uint32 nbThreads=0) const;
         
         /**
          * Adds the specified entry to the ZipArchive. All the needed hierarchy will be created.
@@ -544,7 +718,149 @@ namespace libzippp {
          * If the directory exists, the files in it won't be added to the archive.
          */
         bool addEntry(const std::string& entryName) const;
+
+        /**
+         * Starts a batch of additions. Until endBatch is called, the directories created for the parents of the
+         * added entries are remembered, hence each of them is looked up in the archive only once instead of once
+         * per added entry. If a timestamp is specified, it is used as the modification time of all the entries
+         * and directories added during the batch instead of the current time. Deleting or renaming a directory
+         * forgets the remembered ones. The batch ends when the ZipArchive is closed or discarded.
+         */
+        void beginBatch(time_t timestamp=0) const;
+        void endBatch(void) const;
+        inline bool isBatchOpen(void) const { return batchOpen; }
+        
+        /**
+         * Enables an in-memory hash index of the entry names. When enabled, the lookups made by hasEntry, getEntry
+         * and locateEntry in the Current state are resolved through the index instead of zip_name_locate, which
+         * makes them constant-time even when they are case-insensitive. The excludeDirectories lookups still
+         * rely on libzip.
+         * The index is built when the archive is open (or right away if it is already open) and is kept up
+         * to date by the addFile, addData, addEntry, renameEntry and deleteEntry methods. Changes made directly
+         * through the libzip handle (see ZipArchive::getZipHandle) are not tracked.
+         */
+        void setEntryIndexEnabled(bool enabled);
+        inline bool isEntryIndexEnabled(void) const { return entryIndexEnabled; }
+
+        /**
+         * Enables the asynchronous decompression in the chunked ZipArchive::readEntry methods (and ZipEntry::readContent).
+         * When enabled, the next chunk is decompressed by a worker thread while the output function processes the
+         * current one, hence the decompression and the processing of the data overlap. Two chunks are held in memory
+         * instead of one. While an entry is read that way, the output function must not use this ZipArchive.
+         * The entries smaller than a chunk are still read synchronously.
+         */
+        inline void setReadAheadEnabled(bool enabled) { readAheadEnabled = enabled; }
+        inline bool isReadAheadEnabled(void) const { return readAheadEnabled; }
+
+        /**
+         * Defines the decompressor inflating in one shot the DEFLATE entries read entirely in memory (readEntry,
+         * readEntryInto, ZipEntry::readAsText and ZipEntry::readAsBinaryString), whose uncompressed size is known.
+         * By default, the zlib backend is used (see ZipInflateBackend), only for the archives created from in-memory
+         * data (ZipArchive::fromBuffer, ZipArchive::fromWritableBuffer or ZipArchive::fromMappedFile). With the other
+         * backends, the compressed data of the entries of the other archives is first read entirely in memory.
+         * The partial and chunked reads, the encrypted entries and, unless the archive is open in ReadOnly mode, the
+         * entries in the Current state are inflated by libzip while being read, as well as all the entries if the
+         * backend is null. If the backend fails to inflate an entry or if its CRC doesn't match, the entry is read by
+         * libzip instead.
+         * The backend is not deleted by the ZipArchive.
+         */
+        inline void setInflateBackend(ZipInflateBackend* backend) { inflateBackend = backend; }
+        inline ZipInflateBackend* getInflateBackend(void) const { return inflateBackend; }
+
+        /**
+         * Enables a cache of the decompressed entries, which holds at most maxSize bytes (zero, the default, disables it).
+         * The entries entirely read by readEntry, readEntryInto, ZipEntry::readAsText and ZipEntry::readAsBinaryString
+         * are kept in the cache, so the next reads of the same entry (in the same state) are copied from it instead of
+         * being decompressed again. The chunked readEntry methods are also served from the cache, but don't fill it.
+         * When the cache is full, the least recently used entries are evicted. The entries bigger than maxSize are
+         * never cached. The entries replaced or deleted in the Current state are removed from the cache and the cache
+         * is cleared when the ZipArchive is closed.
+         */
+        void setEntryCacheSize(libzippp_uint64 maxSize);
+        inline libzippp_uint64 getEntryCacheSize(void) const { return entryCacheSize; }
+        
+        /**
+         * Returns the number of bytes currently held in the entry cache.
+         */
+        inline libzippp_uint64 getEntryCacheUsage(void) const { return entryCacheUsage; }
+        
+        /**
+         * Returns the number of reads served from the entry cache (hits) and the number of reads that had
+         * to decompress the entry while the cache is enabled (misses). The reads by chunks, which never fill the
+         * cache, are not counted as misses.
+         */
+        inline libzippp_uint64 getEntryCacheHits(void) const { return entryCacheHits; }
+        inline libzippp_uint64 getEntryCacheMisses(void) const { return entryCacheMisses; }
         
+        /**
+         * Removes all the entries from the cache and resets the hits and misses counters.
+         */
+        void clearEntryCache(void);
+
+        /**
+         * Defines the number of threads used to compress the entries added by addData and addFile (zero, the default,
+         * disables it). When enabled, the entries to be compressed with DEFLATE (the default method) are compressed
+         * concurrently by a pool of worker threads when the ZipArchive is closed, then libzip only writes the compressed
+         * data in the archive, in the same order as before. To bound the memory usage, at most two compressed entries
+         * per thread are waiting to be written. The entries using another compression method, or whose compression
+         * has been changed with ZipEntry::setCompressionMethod or ZipEntry::setCompressionLevel, are still compressed
+         * by libzip. Since the whole compressed data of an entry is held in memory, the entries larger than 64MB are
+         * also compressed by libzip, which streams them. This value must be defined before the entries are added.
+         */
+        inline void setCompressionThreads(libzippp_uint32 nbThreads) { compressionThreads = nbThreads; }
+        inline libzippp_uint32 getCompressionThreads(void) const { return compressionThreads; }
+
+        /**
+         * Starts the compression of the entries in the pool (see ZipArchive::setCompressionThreads) as soon as they are
+         * added by addData or addFile, instead of waiting for the ZipArchive to be closed. Hence the compression
+         * overlaps the production of the entries and close mostly writes the already compressed data. If the number of
+         * compression threads is zero, a single worker thread is used. The compressed data is held in memory until
+         * the ZipArchive is closed and counts in the pending data (see ZipArchive::setPendingDataLimit). The workers
+         * stop once they hold as much compressed data as the pending data limit (256MB if there is none), then the
+         * remaining entries are compressed when the archive is closed. The entries replaced or deleted before close
+         * are not compressed. This value must be defined before the entries are added.
+         */
+        inline void setEagerCompressionEnabled(bool enabled) { eagerCompressionEnabled = enabled; }
+        inline bool isEagerCompressionEnabled(void) const { return eagerCompressionEnabled; }
+
+        /**
+         * Enables the append commit of the archives open in Write mode from a file. When the only changes are new
+         * entries added by addData, addFile or addEntry, close writes their local headers and data after the existing
+         * entries and then rewrites only the central directory, instead of letting libzip write a whole copy of the
+         * archive in a temporary file. Hence the cost of the commit depends on the size of the new entries only.
+         * The new entries are stored or compressed with DEFLATE. In the other cases (deletion, renaming or
+         * modification of an existing entry, comments, encryption, other compression methods or custom compression
+         * levels), or if the append fails, the archive is committed by libzip as usual. Changes made directly through
+         * the libzip handle (see ZipArchive::getZipHandle) are not tracked.
+         */
+        inline void setAppendCommitEnabled(bool enabled) { appendCommitEnabled = enabled; }
+        inline bool isAppendCommitEnabled(void) const { return appendCommitEnabled; }
+
+        /**
+         * Returns true if the last call to close has committed the archive by appending the new entries to the
+         * existing file (see ZipArchive::setAppendCommitEnabled), false if it has been committed by libzip.
+         */
+        inline bool isLastCommitAppended(void) const { return lastCommitAppended; }
+
+        /**
+         * Defines the maximum amount of memory held by the data added with the addData methods until the ZipArchive
+         * is closed (zero, the default, means no limit). Once the limit would be exceeded, the data of the next entries
+         * is written in temporary files instead, and released right away if it is owned by the ZipArchive (freeData or
+         * the addData methods taking the ownership). The temporary files are created in the specified directory, or
+         * in the one of the system if it is empty, and removed once the archive has been closed. The spilled entries
+         * are compressed by libzip, not by the compression threads.
+         */
+        inline void setPendingDataLimit(libzippp_uint64 maxSize) { pendingDataLimit = maxSize; }
+        inline libzippp_uint64 getPendingDataLimit(void) const { return pendingDataLimit; }
+        inline void setSpillDirectory(const std::string& directory) { spillDirectory = directory; }
+        inline const std::string& getSpillDirectory(void) const { return spillDirectory; }
+
+        /**
+         * Returns the amount of memory held by the data added since the ZipArchive has been open, including the
+         * compressed data of the entries already compressed by the eager compression.
+         */
+        libzippp_uint64 getPendingDataSize(void) const;
+
         /**
          * Returns the mode in which the file has been open.
          * If the archive is not open, then NOT_OPEN will be returned.
@@ -625,6 +941,71 @@ namespace libzippp {
         void** bufferData;
         libzippp_uint64 bufferLength;
 
+        //in-memory data the archive has been open from (Original state)
+        const void* originalData;
+        libzippp_uint64 originalDataLength;
+
+        //offsets of the local headers within the original data, lazily read from the central directory
+        mutable std::vector<libzippp_uint64> localHeaderOffsets;
+
+        //memory mapping of the archive file (fromMappedFile)
+        void* mappedData;
+        libzippp_uint64 mappedLength;
+
+        //hash of the entry names (case-insensitive) -> index of the entries in the Current state
+        bool entryIndexEnabled;
+        mutable std::unordered_multimap<libzippp_uint64, libzippp_uint64> entryIndex;
+
+        //sorted entry names -> index of the entries in the Current state, lazily built
+        mutable bool pathIndexLoaded;
+        mutable std::multimap<std::string, libzippp_uint64> pathIndex;
+
+        //decompress the next chunk in a worker thread in the chunked read
+        bool readAheadEnabled;
+
+        //one-shot decompression of the entries entirely read
+        ZipInflateBackend* inflateBackend;
+
+        //decompressed entries, the most recently used first, and their position by key (see ZipArchive::cacheKey)
+        struct CachedEntry {
+            libzippp_uint64 key;
+            std::shared_ptr<const std::vector<char> > data;
+        };
+        libzippp_uint64 entryCacheSize;
+        mutable libzippp_uint64 entryCacheUsage;
+        mutable libzippp_uint64 entryCacheHits;
+        mutable libzippp_uint64 entryCacheMisses;
+        mutable std::list<CachedEntry> entryCache;
+        mutable std::unordered_map<libzippp_uint64, std::list<CachedEntry>::iterator> entryCacheKeys;
+
+        //entries to be compressed by the worker threads when the archive is closed (or when added), by index
+        libzippp_uint32 compressionThreads;
+        bool eagerCompressionEnabled;
+        mutable std::map<libzippp_uint64, std::shared_ptr<ZipCompressionJob> > compressionJobs;
+        mutable ZipCompressionPool* compressionPool;
+
+        //data added in memory since the archive has been open, by index, with its owner if the ZipArchive took the
+        //ownership (see the addData methods), spilled to temporary files above the limit
+        struct PendingData {
+            libzippp_uint64 size;
+            std::shared_ptr<void> owner;
+        };
+        mutable std::map<libzippp_uint64, PendingData> pendingData;
+        libzippp_uint64 pendingDataLimit;
+        mutable libzippp_uint64 pendingDataSize;
+        std::string spillDirectory;
+
+        //directories already created during the current batch of additions (see beginBatch)
+        mutable bool batchOpen;
+        mutable time_t batchTime;
+        mutable std::unordered_set<std::string> batchDirectories;
+
+        //entries added since the archive has been open -> their compression method, for the append commit
+        bool appendCommitEnabled;
+        mutable bool appendable;
+        mutable std::map<libzippp_uint64, libzippp_uint16> addedEntries;
+        bool lastCommitAppended;
+
         bool useArchiveCompressionMethod;
         libzippp_uint16 compressionMethod;
         libzippp_uint32 compressionLevel;
@@ -633,9 +1014,60 @@ namespace libzippp {
         ErrorHandlerCallback* errorHandlingCallback;
         
         //open from in-memory data
-        bool openBuffer(void** buffer, libzippp_uint32 sz, OpenMode mode=ReadOnly, bool checkConsistency=false);
+        bool openBuffer(void** buffer, libzippp_uint64 sz, OpenMode mode=ReadOnly, bool checkConsistency=false);
+        bool openMappedFile(bool checkConsistency=false);
+        void unmapFile(void);
         bool openSource(zip_source* source, OpenMode mode=ReadOnly, bool checkConsistency=false);
+
+        //open a new read-only handle on the same file or buffer (used by the worker threads)
+        zip* openReadHandle(void) const;
+
+        //read the offsets of the local headers from the original archive, if available
+        bool loadLocalHeaderOffsets(void) const;
         
+        //maintenance of the entry names index
+        void buildEntryIndex(void) const;
+        void indexEntry(libzippp_uint64 index) const;
+        void unindexEntry(libzippp_uint64 index) const;
+        void buildPathIndex(void) const;
+
+        //maintenance of the decompressed entries cache
+        libzippp_uint64 cacheKey(libzippp_uint64 index, State state) const;
+        std::shared_ptr<const std::vector<char> > findCachedEntry(const ZipEntry& entry, State state, bool countMiss) const;
+        void cacheEntry(const ZipEntry& entry, State state, const void* data) const;
+        void uncacheEntry(libzippp_uint64 index) const;
+        void evictCachedEntries(libzippp_uint64 maxUsage) const;
+
+        //adds data kept alive by the owner (if any) until the entry is overwritten or deleted, or the archive is closed
+        bool addOwnedData(const std::string& entryName, const std::shared_ptr<void>& owner, const void* data, libzippp_uint64 length, bool freeData) const;
+        void releasePendingData(libzippp_uint64 index) const;
+        bool isOverPendingDataLimit(libzippp_uint64 length) const;
+
+        //original compressed data of the entry within the data the archive has been created from, null if not available
+        const void* findOriginalData(libzippp_uint64 index, libzippp_uint64 length) const;
+
+        //inflates the whole entry with the backend, returns false if it must be read by libzip instead
+        bool inflateEntry(const ZipEntry& zipEntry, void* buffer, State state) const;
+
+        //adds a file from its source, which is released if it can't be added (the Unix mode of the file is zero if unknown)
+        bool addFileSource(const std::string& entryName, zip_source* source, const std::shared_ptr<ZipCompressionJob>& job, time_t mtime, libzippp_uint32 fileMode) const;
+        time_t addedEntryTime(void) const;
+
+        //parallel compression of the added entries
+        bool isCompressionPoolEnabled(void) const;
+        void scheduleCompression(libzippp_uint64 index, const std::shared_ptr<ZipCompressionJob>& job) const;
+        void submitCompressionJobs(void);
+
+        //append commit of the new entries (see ZipArchive::setAppendCommitEnabled)
+        void trackAddedEntry(libzippp_uint64 index, libzippp_uint16 compMethod) const;
+        void trackChange(libzippp_uint64 index) const;
+        bool isAppendCommitPossible(void) const;
+        bool commitAppend(void);
+        bool appendEntry(std::ostream& output, libzippp_uint64 index, libzippp_uint16 compMethod, libzippp_uint64* offset, std::vector<libzippp_uint8>& centralDirectory) const;
+
+        //indexes of the entries whose name starts with prefix (and matches the pattern, if any), sorted by name
+        void findEntries(const std::string& prefix, const std::string* pattern, State state, std::vector<libzippp_uint64>& indexes) const;
+
         //generic method to create ZipEntry
         ZipEntry createEntry(struct zip_stat* stat) const;
         
@@ -673,12 +1105,43 @@ namespace libzippp {
         virtual int cancel(void) = 0;
     };
     
+    /**
+     * Decompressor inflating a whole entry in one shot, when its compressed data and its uncompressed size are
+     * both known (see ZipArchive::setInflateBackend). Unlike the streaming inflate of libzip, the decompressor can
+     * rely on the whole input and output being available.
+     */
+    class LIBZIPPP_API ZipInflateBackend {
+    public:
+        virtual ~ZipInflateBackend(void) {}
+
+        /**
+         * Inflates the raw DEFLATE data (without zlib or gzip header) of the input into the output, whose length is
+         * the uncompressed size of the entry. Returns true only if the whole data has been inflated and filled exactly
+         * the output. This method may be invoked concurrently by several threads.
+         */
+        virtual bool inflate(const void* input, libzippp_uint64 inputLength, void* output, libzippp_uint64 outputLength) const = 0;
+
+        /**
+         * Returns the CRC-32 of the data, used to verify the inflated entries. By default, the one of zlib.
+         */
+        virtual libzippp_uint32 crc32(const void* data, libzippp_uint64 length) const;
+
+        /**
+         * Returns the backend based on zlib (the default one), or the one based on libdeflate if libzippp has been built
+         * with LIBZIPPP_WITH_LIBDEFLATE (null otherwise). These backends are shared and must not be deleted.
+         */
+        static ZipInflateBackend* zlib(void);
+        static ZipInflateBackend* libdeflate(void);
+    };
+    
     /**
      * Represents an entry in a zip file.
      * This class is meant to be used by the ZipArchive class.
      */
     class LIBZIPPP_API ZipEntry {
     friend class ZipArchive;
+    friend class ZipEntryReader;
+    friend class ZipEntryStreamBuf;
     public:
         /**
          * Creates a new null-ZipEntry. Only a ZipArchive will create a valid ZipEntry
@@ -801,6 +1264,14 @@ namespace libzippp {
          */
         int readContent(std::ostream& ofOutput, ZipArchive::State state=ZipArchive::Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE) const;
         
+        /**
+         * Opens this ZipEntry as a std::istream (see ZipEntryStream). The decompressed data is pulled from the archive
+         * with chunks of size "chunksize" while the stream is read, hence the entry is never entirely held in memory.
+         * Returns null if the ZipArchive is not open or if the entry couldn't be opened.
+         * The stream must be deleted by the developer once not used anymore, before the ZipArchive is closed.
+         */
+        std::istream* openStream(ZipArchive::State state=ZipArchive::Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE) const;
+        
     private:
         const ZipArchive* zipFile;
         std::string name;
@@ -816,6 +1287,531 @@ namespace libzippp {
         ZipEntry(const ZipArchive* zipFile, const std::string& name, libzippp_uint64 index, time_t time, libzippp_uint16 compMethod, libzippp_uint32 compLevel, libzippp_uint16 encMethod, libzippp_uint64 size, libzippp_uint64 sizeComp, int crc) : 
                 zipFile(zipFile), name(name), index(index), time(time), compressionMethod(compMethod), compressionLevel(compLevel), encryptionMethod(encMethod), size(size), sizeComp(sizeComp), crc(crc) {}
     };
+
+    /**
+     * Input iterator over the entries of a ZipArchive, created through ZipArchive::iterateEntries.
+     * The entries are read from libzip one by one, as the iterator is incremented.
+     * The deleted entries are skipped.
+     */
+    class LIBZIPPP_API ZipEntryIterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef ZipEntry value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const ZipEntry* pointer;
+        typedef const ZipEntry& reference;
+
+        /**
+         * Creates an iterator over the entries of zipFile, from index up to end (excluded).
+         */
+        ZipEntryIterator(const ZipArchive* zipFile, libzippp_int64 index, libzippp_int64 end, ZipArchive::State state);
+
+        inline reference operator*(void) const { return entry; }
+        inline pointer operator->(void) const { return &entry; }
+
+        ZipEntryIterator& operator++(void);
+        ZipEntryIterator operator++(int);
+
+        inline bool operator==(const ZipEntryIterator& other) const { return index==other.index && zipFile==other.zipFile; }
+        inline bool operator!=(const ZipEntryIterator& other) const { return !(*this==other); }
+
+    private:
+        const ZipArchive* zipFile;
+        libzippp_int64 index;
+        libzippp_int64 end;
+        ZipArchive::State state;
+        ZipEntry entry;
+
+        //loads the first valid entry starting at the current index
+        void load(void);
+    };
+
+    /**
+     * Range of entries of a ZipArchive, created through ZipArchive::iterateEntries.
+     */
+    class LIBZIPPP_API ZipEntryRange {
+    public:
+        ZipEntryRange(const ZipArchive* zipFile, libzippp_int64 first, libzippp_int64 last, ZipArchive::State state) :
+                zipFile(zipFile), first(first), last(last), state(state) {}
+
+        inline ZipEntryIterator begin(void) const { return ZipEntryIterator(zipFile, first, last, state); }
+        inline ZipEntryIterator end(void) const { return ZipEntryIterator(zipFile, last, last, state); }
+
+    private:
+        const ZipArchive* zipFile;
+        libzippp_int64 first;
+        libzippp_int64 last;
+        ZipArchive::State state;
+    };
+
+    /**
+     * Random access reader over the content of a ZipEntry.
+     * For the entries stored without compression (STORE), readRange directly seeks to the requested offset.
+     * For the DEFLATE entries, the first call decompresses the entry once and records a checkpoint (position in the
+     * compressed data and the last 32KB of decompressed data) every checkpointInterval bytes. The next calls resume
+     * the decompression from the closest checkpoint, hence at most checkpointInterval bytes are decompressed before
+     * reaching the requested offset. Each checkpoint costs about 32KB of memory.
+     * The checkpoints are only available for the unencrypted entries whose compressed data can be read from the
+     * archive (not modified in the Current state). Otherwise, or if checkpointInterval is zero, the entry is
+     * decompressed from its beginning on each call.
+     * The ZipArchive must stay open while the reader is used. Changes made to the entry after the first read
+     * are not considered.
+     */
+    class LIBZIPPP_API ZipEntryReader {
+    public:
+        explicit ZipEntryReader(const ZipEntry& entry, ZipArchive::State state=ZipArchive::Current, libzippp_uint64 checkpointInterval=LIBZIPPP_DEFAULT_CHECKPOINT_INTERVAL);
+        
+        /**
+         * Returns the entry read by this reader.
+         */
+        inline const ZipEntry& getEntry(void) const { return entry; }
+        
+        /**
+         * Returns the number of checkpoints recorded for the entry (zero until the first read of a DEFLATE entry).
+         */
+        inline libzippp_uint64 getNbCheckpoints(void) const { return checkpoints.size(); }
+        
+        /**
+         * Reads at most length bytes of the entry, starting at offset, into the provided buffer.
+         * Returns the number of bytes read (less than length if the end of the entry is reached, zero if the offset
+         * is beyond the end of the entry) or LIBZIPPP_ERROR_NOT_OPEN if the archive is not open, LIBZIPPP_ERROR_INVALID_ENTRY
+         * if the entry is null, LIBZIPPP_ERROR_INVALID_PARAMETER if the buffer is null, LIBZIPPP_ERROR_FOPEN_FAILURE
+         * if zip_fopen_index() has failed, LIBZIPPP_ERROR_MEMORY_ALLOCATION if a memory allocation has failed and
+         * LIBZIPPP_ERROR_FREAD_FAILURE if the data couldn't be read or decompressed.
+         */
+        libzippp_int64 readRange(libzippp_uint64 offset, void* buffer, libzippp_uint64 length);
+        
+    private:
+        struct Checkpoint {
+            libzippp_uint64 uncompressedOffset;
+            libzippp_uint64 compressedOffset;
+            int bits; //bits of the byte before compressedOffset that belong to the next block
+            std::vector<libzippp_uint8> window; //decompressed data right before the checkpoint
+        };
+
+        ZipEntry entry;
+        ZipArchive::State state;
+        libzippp_uint64 checkpointInterval;
+        bool checkpointsBuilt;
+        std::vector<Checkpoint> checkpoints;
+
+        //decompresses the whole entry once to record the checkpoints
+        void buildCheckpoints(void);
+        libzippp_int64 readFromCheckpoint(const Checkpoint& checkpoint, libzippp_uint64 offset, void* buffer, libzippp_uint64 length) const;
+    };
+
+    /**
+     * Stream buffer reading the decompressed content of a ZipEntry, with chunks of size "chunksize".
+     * Seeking is supported: within the current chunk it is free, otherwise the entry is seeked directly
+     * if libzip allows it (entries stored without compression), or read again from its beginning.
+     * The ZipArchive must stay open while the stream buffer is used.
+     */
+    class LIBZIPPP_API ZipEntryStreamBuf : public std::streambuf {
+    public:
+        explicit ZipEntryStreamBuf(const ZipEntry& entry, ZipArchive::State state=ZipArchive::Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE);
+        virtual ~ZipEntryStreamBuf(void);
+
+        /**
+         * Returns true if the entry has been successfully opened.
+         */
+        inline bool isOpen(void) const { return zipFile!=nullptr; }
+
+    protected:
+        virtual int_type underflow(void);
+        virtual std::streamsize xsgetn(char* s, std::streamsize n);
+        virtual std::streamsize showmanyc(void);
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which=std::ios_base::in);
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which=std::ios_base::in);
+
+    private:
+        zip* zipHandle;
+        struct zip_file* zipFile;
+        libzippp_uint64 index;
+        int flag;
+        libzippp_uint64 size;
+        libzippp_uint64 position; //number of bytes read from zipFile
+        std::vector<char> buffer;
+
+        //prevent copy
+        ZipEntryStreamBuf(const ZipEntryStreamBuf& buf);
+        ZipEntryStreamBuf& operator=(const ZipEntryStreamBuf&);
+    };
+
+    /**
+     * Input stream over the decompressed content of a ZipEntry (see ZipEntryStreamBuf).
+     * If the entry couldn't be opened, the failbit of the stream is set.
+     */
+    class LIBZIPPP_API ZipEntryStream : public std::istream {
+    public:
+        explicit ZipEntryStream(const ZipEntry& entry, ZipArchive::State state=ZipArchive::Current, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE);
+
+        /**
+         * Returns true if the entry has been successfully opened.
+         */
+        inline bool isOpen(void) const { return streamBuf.isOpen(); }
+
+    private:
+        ZipEntryStreamBuf streamBuf;
+    };
+
+    /**
+     * Writes a ZIP archive sequentially in a std::ostream or through a write function, without ever seeking back.
+     * The data of each entry is compressed while it is written and is followed by a data descriptor holding its CRC
+     * and sizes, then the central directory is written by ZipStreamWriter::finish. Hence an archive can be streamed
+     * to a pipe, a socket or an HTTP response without being staged anywhere. Only the central directory records
+     * (about 50 bytes per entry plus its name) are kept in memory until the end.
+     * As with ZipArchive, the parent directories of the entries are created automatically.
+     */
+    class LIBZIPPP_API ZipStreamWriter {
+    public:
+        explicit ZipStreamWriter(std::ostream& output);
+        explicit ZipStreamWriter(const std::function<bool(const void*,libzippp_uint64)>& writeFunc);
+
+        /**
+         * Finishes the archive if it has not been done yet.
+         */
+        virtual ~ZipStreamWriter(void);
+
+        /**
+         * Defines the compression method of the next entries (DEFLATE by default). Only STORE and DEFLATE are
+         * supported (DEFAULT being DEFLATE), false is returned for the other methods.
+         */
+        bool setCompressionMethod(CompressionMethod comp);
+        CompressionMethod getCompressionMethod(void) const;
+
+        /**
+         * Defines the compression level, between 1 and 9. By default this value is zero to use the default level of libzip.
+         */
+        inline void setCompressionLevel(libzippp_uint32 level) { compressionLevel = level; }
+        inline libzippp_uint32 getCompressionLevel(void) const { return compressionLevel; }
+
+        /**
+         * Defines the comment of the archive, written by ZipStreamWriter::finish.
+         */
+        inline void setComment(const std::string& str) { comment = str; }
+
+        /**
+         * Writes the directory entryName (which must end with a '/') and its missing parent directories.
+         */
+        bool addEntry(const std::string& entryName);
+
+        /**
+         * Writes an entry with the specified data or with the content of the specified file.
+         */
+        bool addData(const std::string& entryName, const void* data, libzippp_uint64 length);
+        bool addFile(const std::string& entryName, const std::string& file);
+
+        /**
+         * Starts an entry whose content is then provided by any number of calls to writeEntryData, until
+         * closeEntry is invoked. Only one entry can be written at a time. The size of the content, if known, avoids
+         * the Zip64 fields for the entries smaller than 4GB (a negative size means unknown), in which case closeEntry
+         * fails if the written content exceeds 4GB.
+         */
+        bool openEntry(const std::string& entryName, libzippp_int64 size=-1);
+        bool writeEntryData(const void* data, libzippp_uint64 length);
+        bool closeEntry(void);
+
+        /**
+         * Closes the current entry, if any, and writes the central directory. No entry can be added afterwards.
+         * Returns LIBZIPPP_OK if the whole archive has been written, or LIBZIPPP_ERROR_OWRITE_FAILURE otherwise.
+         */
+        int finish(void);
+
+        /**
+         * Returns true once the archive has been finished.
+         */
+        inline bool isFinished(void) const { return finished; }
+
+        /**
+         * Returns the number of entries and the number of bytes written so far.
+         */
+        inline libzippp_uint64 getNbEntries(void) const { return nbEntries; }
+        inline libzippp_uint64 getWrittenSize(void) const { return offset; }
+
+    private:
+        std::function<bool(const void*,libzippp_uint64)> writeFunc;
+        libzippp_uint16 compressionMethod;
+        libzippp_uint32 compressionLevel;
+        std::string comment;
+        struct z_stream_s* stream;
+        std::vector<libzippp_uint8> buffer;
+        libzippp_uint64 offset;
+        libzippp_uint64 nbEntries;
+        std::vector<libzippp_uint8> centralDirectory;
+        std::unordered_set<std::string> directories;
+        bool finished;
+        bool failed;
+
+        //entry being written
+        bool entryOpen;
+        std::string entryName;
+        libzippp_uint16 entryMethod;
+        bool entryZip64;
+        libzippp_uint32 entryMode; //Unix mode of the added file, zero if unknown
+        time_t entryTime;
+        libzippp_uint64 entryOffset;
+        libzippp_uint64 entrySize;
+        libzippp_uint64 entryCompSize;
+        libzippp_uint32 entryCrc;
+
+        bool write(const void* data, libzippp_uint64 length);
+        bool deflateEntryData(const void* data, libzippp_uint64 length, bool finish);
+        bool startEntry(const std::string& name, libzippp_uint16 method, bool zip64);
+        bool addParentDirectories(const std::string& name);
+
+        //prevent copy
+        ZipStreamWriter(const ZipStreamWriter& writer);
+        ZipStreamWriter& operator=(const ZipStreamWriter&);
+    };
+
+    /**
+     * Reads a ZIP archive sequentially from a std::istream or through a read function, without ever seeking.
+     * The entries are discovered through their local headers, in the order in which they are stored, and their
+     * content is decompressed as it arrives. Hence an archive can be processed directly from a pipe, a socket or an
+     * HTTP upload, without being buffered in memory or spooled to disk first.
+     * The central directory is never read: the entries that have been replaced or deleted in place by some tools
+     * might thus be returned, and the attributes and comments of the entries are not available.
+     * When the CRC and sizes of an entry are stored in a data descriptor after its data (as written by
+     * ZipStreamWriter), the end of the data is found by the decompression for DEFLATE entries and by looking for a
+     * data descriptor matching the data read so far for the STORE entries.
+     * Only the unencrypted STORE and DEFLATE entries can be read. The other entries can only be skipped if their
+     * compressed size is known from their local header.
+     */
+    class LIBZIPPP_API ZipStreamReader {
+    public:
+        explicit ZipStreamReader(std::istream& input);
+        explicit ZipStreamReader(const std::function<libzippp_int64(void*,libzippp_uint64)>& readFunc);
+        virtual ~ZipStreamReader(void);
+
+        /**
+         * Moves to the next entry, skipping the content of the current entry that has not been read.
+         * Returns 1 if an entry is available, 0 once all the entries have been read (the central directory is reached),
+         * LIBZIPPP_ERROR_INVALID_ENTRY if the current entry can't be skipped or LIBZIPPP_ERROR_FREAD_FAILURE if the
+         * input couldn't be read or is not a valid archive. No entry can be read after an error.
+         */
+        int nextEntry(void);
+
+        /**
+         * Returns the name of the current entry.
+         */
+        inline const std::string& getName(void) const { return entryName; }
+
+        /**
+         * Returns true if the current entry is a directory (its name ends with a '/').
+         */
+        inline bool isDirectory(void) const { return LIBZIPPP_ENTRY_IS_DIRECTORY(entryName); }
+        inline bool isFile(void) const { return !isDirectory(); }
+
+        /**
+         * Returns the compression method and the last modification date of the current entry.
+         */
+        CompressionMethod getCompressionMethod(void) const;
+        inline time_t getDate(void) const { return entryTime; }
+
+        /**
+         * Returns true if the current entry is encrypted. Its content can't be read.
+         */
+        inline bool isEncrypted(void) const { return (entryFlags & 0x0001)!=0; }
+
+        /**
+         * Returns true if the CRC and sizes of the current entry are stored after its data. In this case, getSize,
+         * getDeflatedSize and getCRC return zero until the content of the entry has been entirely read.
+         */
+        inline bool hasDataDescriptor(void) const { return (entryFlags & 0x0008)!=0; }
+
+        /**
+         * Returns the size, compressed size and CRC of the current entry.
+         */
+        inline libzippp_uint64 getSize(void) const { return entrySize; }
+        inline libzippp_uint64 getDeflatedSize(void) const { return entryCompSize; }
+        inline int getCRC(void) const { return (int)entryCrc; }
+
+        /**
+         * Reads at most length bytes of the content of the current entry in the provided buffer.
+         * Returns the number of bytes read, zero once the entry has been entirely read (its CRC and sizes being then
+         * verified), LIBZIPPP_ERROR_INVALID_ENTRY if there is no current entry or if its content can't be read
+         * (encryption or unsupported compression method), LIBZIPPP_ERROR_INVALID_PARAMETER if the buffer is null or
+         * LIBZIPPP_ERROR_FREAD_FAILURE if the input couldn't be read, is corrupted or doesn't match the CRC or sizes.
+         */
+        libzippp_int64 read(void* buffer, libzippp_uint64 length);
+
+        /**
+         * Reads the remaining content of the current entry as a string. An empty string is returned if the content
+         * couldn't be read.
+         */
+        std::string readAsText(void);
+
+        /**
+         * Writes the remaining content of the current entry in the specified stream, with chunks of "chunksize" bytes.
+         * Returns LIBZIPPP_OK if the content has been entirely written, LIBZIPPP_ERROR_OWRITE_FAILURE if the stream
+         * failed or any error code of ZipStreamReader::read.
+         */
+        int readContent(std::ostream& ofOutput, libzippp_uint64 chunksize=LIBZIPPP_DEFAULT_CHUNK_SIZE);
+
+        /**
+         * Returns the number of entries found so far and the number of bytes consumed from the input.
+         */
+        inline libzippp_uint64 getNbEntries(void) const { return nbEntries; }
+        inline libzippp_uint64 getReadSize(void) const { return consumed; }
+
+    private:
+        std::function<libzippp_int64(void*,libzippp_uint64)> readFunc;
+        std::vector<libzippp_uint8> input;
+        libzippp_uint64 inputStart; //position of the first unconsumed byte in input
+        libzippp_uint64 inputEnd;
+        libzippp_uint64 consumed;
+        struct z_stream_s* stream;
+        libzippp_uint64 nbEntries;
+        bool ended;
+        bool failed;
+
+        //current entry
+        bool entryOpen;
+        bool entryDone; //the data and the data descriptor have been read
+        std::string entryName;
+        libzippp_uint16 entryFlags;
+        libzippp_uint16 entryMethod;
+        time_t entryTime;
+        bool entryZip64;
+        libzippp_uint64 entrySize;
+        libzippp_uint64 entryCompSize;
+        libzippp_uint32 entryCrc;
+        libzippp_uint64 readSize;
+        libzippp_uint64 readCompSize;
+        libzippp_uint32 readCrc;
+
+        //ensures that at least length unconsumed bytes are in input, returns false at the end of the input
+        bool fill(libzippp_uint64 length);
+        void consume(libzippp_uint64 length);
+        libzippp_int64 readStored(libzippp_uint8* buffer, libzippp_uint64 length);
+        libzippp_int64 readDeflated(libzippp_uint8* buffer, libzippp_uint64 length);
+        libzippp_uint64 matchDataDescriptor(libzippp_uint64 at);
+        bool readDataDescriptor(void);
+        bool finishEntry(void);
+        bool skipEntry(void);
+        libzippp_int64 fail(void);
+
+        //prevent copy
+        ZipStreamReader(const ZipStreamReader& reader);
+        ZipStreamReader& operator=(const ZipStreamReader&);
+    };
+
+    /**
+     * Compact representation of the metadata of the entries of a ZipArchive, created by ZipArchive::getEntryTable.
+     * The names of the entries are packed in a single buffer and the other fields are stored in parallel arrays,
+     * all of them being accessed through the position of the entry in the table (from 0 to size()-1).
+     * The table is a snapshot: it is not updated when the ZipArchive is modified.
+     */
+    class LIBZIPPP_API ZipEntryTable {
+    friend class ZipArchive;
+    public:
+        /**
+         * Creates a new empty table.
+         */
+        ZipEntryTable(void) : totalSize(0), totalDeflatedSize(0), nbDirectories(0) {}
+        virtual ~ZipEntryTable(void) {}
+
+        /**
+         * Returns the number of entries in the table.
+         */
+        inline libzippp_uint64 size(void) const { return indexes.size(); }
+        inline bool empty(void) const { return indexes.empty(); }
+
+        /**
+         * Returns the name of the entry at the specified position. The getNameData method returns a
+         * null-terminated pointer within the table and does not allocate anything.
+         */
+        inline std::string getName(libzippp_uint64 i) const { return std::string(getNameData(i), getNameLength(i)); }
+        inline const char* getNameData(libzippp_uint64 i) const { return names.data()+nameOffsets[i]; }
+        inline libzippp_uint64 getNameLength(libzippp_uint64 i) const { return nameOffsets[i+1]-nameOffsets[i]-1; }
+
+        /**
+         * Returns the index of the entry in the ZipArchive. The corresponding ZipEntry
+         * can be retrieved with ZipArchive::getEntry.
+         */
+        inline libzippp_uint64 getIndex(libzippp_uint64 i) const { return indexes[i]; }
+
+        /**
+         * Returns the timestamp of the entry.
+         */
+        inline time_t getDate(libzippp_uint64 i) const { return times[i]; }
+
+        /**
+         * Returns the size of the entry (uncompressed).
+         */
+        inline libzippp_uint64 getSize(libzippp_uint64 i) const { return sizes[i]; }
+
+        /**
+         * Returns the size of the entry (compressed).
+         */
+        inline libzippp_uint64 getDeflatedSize(libzippp_uint64 i) const { return deflatedSizes[i]; }
+
+        /**
+         * Returns the CRC of the entry.
+         */
+        inline int getCRC(libzippp_uint64 i) const { return (int)crcs[i]; }
+
+        /**
+         * Returns the compression method of the entry.
+         */
+        CompressionMethod getCompressionMethod(libzippp_uint64 i) const;
+
+        /**
+         * Returns the encryption method of the entry (see ZipEntry::getEncryptionMethod).
+         */
+        inline libzippp_uint16 getEncryptionMethod(libzippp_uint64 i) const { return encryptionMethods[i]; }
+
+        /**
+         * Returns true if the entry is a directory.
+         */
+        inline bool isDirectory(libzippp_uint64 i) const { return getNameLength(i)>0 && getNameData(i)[getNameLength(i)-1]==LIBZIPPP_ENTRY_PATH_SEPARATOR; }
+
+        /**
+         * Returns true if the offsets of the local headers are available. This is only the case
+         * when the table has been created from the original content of an archive open from a file,
+         * a buffer or a mapped file (ReadOnly mode or Original state).
+         */
+        inline bool hasOffsets(void) const { return offsets.size()==indexes.size(); }
+
+        /**
+         * Returns the offset of the local header of the entry within the archive.
+         * This value is only relevant if hasOffsets returns true.
+         */
+        inline libzippp_uint64 getOffset(libzippp_uint64 i) const { return hasOffsets() ? offsets[i] : 0; }
+
+        /**
+         * Returns the total size of the entries (uncompressed and compressed).
+         */
+        inline libzippp_uint64 getTotalSize(void) const { return totalSize; }
+        inline libzippp_uint64 getTotalDeflatedSize(void) const { return totalDeflatedSize; }
+
+        /**
+         * Returns the number of files and directories in the table.
+         */
+        inline libzippp_uint64 getNbFiles(void) const { return size()-nbDirectories; }
+        inline libzippp_uint64 getNbDirectories(void) const { return nbDirectories; }
+
+        /**
+         * Returns the number of entries compressed with the specified method.
+         */
+        libzippp_uint64 getNbEntries(CompressionMethod compMethod) const;
+
+    private:
+        std::string names;
+        std::vector<libzippp_uint64> nameOffsets;
+        std::vector<libzippp_uint64> indexes;
+        std::vector<time_t> times;
+        std::vector<libzippp_uint64> sizes;
+        std::vector<libzippp_uint64> deflatedSizes;
+        std::vector<libzippp_uint32> crcs;
+        std::vector<libzippp_uint16> compressionMethods;
+        std::vector<libzippp_uint16> encryptionMethods;
+        std::vector<libzippp_uint64> offsets;
+
+        libzippp_uint64 totalSize;
+        libzippp_uint64 totalDeflatedSize;
+        libzippp_uint64 nbDirectories;
+    };
 }
 
 #endif
@@ -0,0 +1,217 @@
+
+/*
+  libzippp.h -- exported declarations.
+  Copyright (C) 2013 Cédric Tabin
+
+  This file is part of libzippp, a library that wraps libzip for manipulating easily
+  ZIP files in C++.
+  The author can be contacted on http://www.astorm.ch/blog/index.php?contact
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+  1. Redistributions of source code must retain the above copyright
+     notice, this list of conditions and the following disclaimer.
+  2. Redistributions in binary form must reproduce the above copyright
+     notice, this list of conditions and the following disclaimer in
+     the documentation and/or other materials provided with the
+     distribution.
+  3. The names of the authors may not be used to endorse or promote
+     products derived from this software without specific prior
+     written permission.
+ 
+  THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS
+  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+  ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY
+  DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+  GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+  IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+  IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "libzippp.h"
+
+using namespace std;
+using namespace libzippp;
+
+#define BENCHMARK_ENTRY_SIZE 4194304 // 4MB
+
+//adds the entries (all pointing to the same data) and closes the archive, returns the elapsed milliseconds
+static double fillArchive(ZipArchive* archive, const vector<char>& data, libzippp_uint64 nbEntries) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    archive->setCompressionMethod(STORE); //measures the handling of the archive, not the compression
+    for(libzippp_uint64 i=0 ; i<nbEntries ; ++i) {
+        archive->addData("entry" + to_string(i) + ".bin", data.data(), data.size());
+    }
+    int result = archive->close();
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    if (result!=LIBZIPPP_OK) {
+        cerr << "unable to close the archive: " << result << endl;
+        exit(1);
+    }
+    return chrono::duration<double, milli>(end-start).count();
+}
+
+static void printResult(const string& name, double ms, libzippp_uint64 size) {
+    cout << name << ": " << (libzippp_uint64)ms << " ms (" << (libzippp_uint64)(size/1048576.0/(ms/1000.0)) << " MB/s)" << endl;
+}
+
+//reads entirely all the files of the archive with the given inflate backend, returns the elapsed milliseconds
+static double readArchive(ZipArchive* archive, ZipInflateBackend* backend, libzippp_uint64* size) {
+    archive->setInflateBackend(backend);
+    vector<ZipEntry> entries = archive->getEntries();
+    vector<libzippp_uint8> content;
+    *size = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(vector<ZipEntry>::const_iterator it=entries.begin() ; it!=entries.end() ; ++it) {
+        if (!it->isFile()) { continue; }
+        if (archive->readEntryInto(*it, content)!=LIBZIPPP_OK) {
+            cerr << "unable to read " << it->getName() << endl;
+            exit(1);
+        }
+        *size += content.size();
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end-start).count();
+}
+
+//compares the streaming inflate of libzip with the one-shot backends
+static void compareInflateBackends(ZipArchive* archive) {
+    const char* names[] = { "inflate by libzip", "inflate by zlib (one-shot)", "inflate by libdeflate (one-shot)" };
+    ZipInflateBackend* backends[] = { nullptr, ZipInflateBackend::zlib(), ZipInflateBackend::libdeflate() };
+    for(int i=0 ; i<3 ; ++i) {
+        if (i>0 && backends[i]==nullptr) {
+            cout << names[i] << ": not available" << endl;
+            continue;
+        }
+        libzippp_uint64 size = 0;
+        double ms = readArchive(archive, backends[i], &size);
+        printResult(names[i], ms, size);
+    }
+}
+
+/**
+ * Measures the creation of large archives in memory (fromWritableBuffer) and on disk, then the inflate backends
+ * on the given archive or on generated text compressed with DEFLATE.
+ * Usage: libzippp_benchmark [size in MB, 256 by default, more than 4096 to cover Zip64] [archive to inflate]
+ */
+int main(int argc, char** argv) {
+    libzippp_uint64 sizeMB = argc>1 ? strtoull(argv[1], nullptr, 10) : 256;
+    libzippp_uint64 nbEntries = sizeMB*1048576/BENCHMARK_ENTRY_SIZE;
+    if (nbEntries==0) { nbEntries = 1; }
+
+    //incompressible data
+    vector<char> data(BENCHMARK_ENTRY_SIZE);
+    libzippp_uint32 seed = 12345;
+    for(vector<char>::iterator it=data.begin() ; it!=data.end() ; ++it) {
+        seed = seed*1103515245 + 12345;
+        *it = (char)(seed>>16);
+    }
+    libzippp_uint64 totalSize = nbEntries*data.size();
+    cout << "Creating archives of " << nbEntries << " entries (" << totalSize/1048576 << " MB)" << endl;
+
+    const char* path = "benchmark.zip";
+    ZipArchive disk(path);
+    disk.open(ZipArchive::New);
+    printResult("disk", fillArchive(&disk, data, nbEntries), totalSize);
+    remove(path);
+
+    void* buffer = nullptr;
+    ZipArchive* memory = ZipArchive::fromWritableBuffer(&buffer, 0, ZipArchive::New);
+    if (memory==nullptr) {
+        cerr << "unable to create the archive in memory" << endl;
+        return 1;
+    }
+    printResult("writable buffer", fillArchive(memory, data, nbEntries), totalSize);
+    libzippp_uint64 length = memory->getBufferLength();
+    ZipArchive::free(memory);
+    if (length<totalSize) {
+        cerr << "unexpected buffer length: " << length << endl;
+        return 1;
+    }
+
+    //archives larger than 4GB are read with the Zip64 extensions
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ZipArchive* reader = ZipArchive::fromBuffer(buffer, length);
+    if (reader==nullptr || reader->getNbEntries()!=(libzippp_int64)nbEntries) {
+        cerr << "unable to read back the archive" << endl;
+        return 1;
+    }
+    vector<ZipEntry> entries = reader->getEntries();
+    string content;
+    for(vector<ZipEntry>::const_iterator it=entries.begin() ; it!=entries.end() ; ++it) {
+        if (reader->readEntryInto(*it, content)!=LIBZIPPP_OK || content.size()!=data.size()) {
+            cerr << "unable to read " << it->getName() << endl;
+            return 1;
+        }
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    printResult("read from buffer", chrono::duration<double, milli>(end-start).count(), totalSize);
+    ZipArchive::free(reader);
+    free(buffer);
+
+    if (argc>2) {
+        //mapped, since the one-shot backends only inflate the archives held in memory
+        ZipArchive* corpus = ZipArchive::fromMappedFile(argv[2]);
+        if (corpus==nullptr) {
+            cerr << "unable to open " << argv[2] << endl;
+            return 1;
+        }
+        cout << "Inflating " << argv[2] << endl;
+        compareInflateBackends(corpus);
+        ZipArchive::free(corpus);
+        return 0;
+    }
+
+    //compressible text made of random words
+    const char* words[] = { "zip ", "archive ", "entry ", "deflate ", "buffer ", "stream ", "data\n", "libzippp " };
+    vector<char> text;
+    text.reserve(BENCHMARK_ENTRY_SIZE);
+    while (text.size()<BENCHMARK_ENTRY_SIZE) {
+        seed = seed*1103515245 + 12345;
+        const char* word = words[(seed>>16)%8];
+        text.insert(text.end(), word, word+strlen(word));
+    }
+    text.resize(BENCHMARK_ENTRY_SIZE);
+
+    buffer = nullptr;
+    ZipArchive* deflated = ZipArchive::fromWritableBuffer(&buffer, 0, ZipArchive::New);
+    if (deflated==nullptr) {
+        cerr << "unable to create the archive in memory" << endl;
+        return 1;
+    }
+    deflated->setCompressionMethod(DEFLATE);
+    for(libzippp_uint64 i=0 ; i<nbEntries ; ++i) {
+        deflated->addData("entry" + to_string(i) + ".txt", text.data(), text.size());
+    }
+    if (deflated->close()!=LIBZIPPP_OK) {
+        cerr << "unable to close the archive" << endl;
+        return 1;
+    }
+    length = deflated->getBufferLength();
+    ZipArchive::free(deflated);
+
+    reader = ZipArchive::fromBuffer(buffer, length);
+    if (reader==nullptr) {
+        cerr << "unable to read back the archive" << endl;
+        return 1;
+    }
+    cout << "Inflating " << nbEntries << " text entries (" << totalSize/1048576 << " MB)" << endl;
+    compareInflateBackends(reader);
+    ZipArchive::free(reader);
+    free(buffer);
+
+    return 0;
+}
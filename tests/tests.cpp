@@ -40,7 +40,20 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+  #include <direct.h>
+  #define mkdir(path, mode) _mkdir(path)
+  #define rmdir(path) _rmdir(path)
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
 
 #include "libzippp.h"
 
@@ -961,12 +974,1353 @@ void test24() {
     cout << " done." << endl;
 }
 
+void test25() {
+    cout << "Running test 25...";
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    map<string, string> contents;
+    for(int i=0 ; i<64 ; ++i) {
+        string name = "folder" + to_string(i%4) + "/file" + to_string(i) + ".txt";
+        contents[name] = string(1000+i*37, (char)('a'+i%26));
+        z1.addData(name, contents[name].c_str(), contents[name].length());
+    }
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+
+    std::mutex lock;
+    map<string, string> extracted;
+    int result = z2.extractAll([&](const ZipEntry& entry, const void* data, libzippp_uint64 size) {
+        std::lock_guard<std::mutex> guard(lock);
+        extracted[entry.getName()].append((const char*)data, size);
+        return true;
+    }, 4, ZipArchive::Current, 100);
+    assert(result==LIBZIPPP_OK);
+    assert(extracted==contents);
+
+    //the first failure stops the extraction
+    result = z2.extractAll([](const ZipEntry&, const void*, libzippp_uint64) { return false; }, 4);
+    assert(result==LIBZIPPP_ERROR_OWRITE_FAILURE);
+
+    ZipArchive other("other.zip");
+    vector<ZipEntry> invalid;
+    invalid.push_back(z2.getEntry("folder0/file0.txt"));
+    assert(other.extractEntries(invalid, [](const ZipEntry&, const void*, libzippp_uint64) { return true; }) == LIBZIPPP_ERROR_NOT_OPEN);
+    other.open(ZipArchive::New);
+    assert(other.extractEntries(invalid, [](const ZipEntry&, const void*, libzippp_uint64) { return true; }) == LIBZIPPP_ERROR_INVALID_ENTRY);
+    other.discard();
+
+    //the exceptions of the output function are rethrown once all the workers are done
+    bool thrown = false;
+    try {
+        z2.extractAll([&thrown](const ZipEntry&, const void*, libzippp_uint64) -> bool { throw std::runtime_error("output"); }, 4);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    z2.close();
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test26() {
+    cout << "Running test 26...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("somedata", txtFile, len);
+    z1.addData("folder/otherdata", txtFile, len);
+    z1.close();
+
+    ZipArchive* z2 = ZipArchive::fromMappedFile("test.zip", true);
+    assert(z2!=nullptr);
+    assert(z2->isOpen());
+    assert(!z2->isMutable());
+    assert(z2->getPath()=="test.zip");
+    assert(z2->getNbEntries()==3);
+    assert(z2->getEntry("somedata").readAsText()==txtFile);
+    assert(z2->getEntry("folder/otherdata").readAsText()==txtFile);
+    assert(!z2->addData("newdata", txtFile, len));
+    assert(z2->close()==LIBZIPPP_OK);
+    assert(!z2->isOpen());
+    ZipArchive::free(z2);
+
+    ZipArchive* z3 = ZipArchive::fromMappedFile("non-existent.zip");
+    assert(z3==nullptr);
+
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
+void test27() {
+    cout << "Running test 27...";
+
+    const char* txtFile = "this is some data that is stored without compression";
+    int len = strlen(txtFile);
+
+    void* buffer = calloc(4096, sizeof(char));
+    ZipArchive* z1 = ZipArchive::fromWritableBuffer(&buffer, 4096, ZipArchive::New);
+    assert(z1!=nullptr);
+    z1->addData("stored/data.txt", txtFile, len);
+    z1->addData("deflated.txt", txtFile, len);
+    ZipEntry stored = z1->getEntry("stored/data.txt");
+    assert(stored.setCompressionMethod(STORE));
+    ZipEntry deflated = z1->getEntry("deflated.txt");
+    assert(deflated.setCompressionMethod(DEFLATE));
+    assert(z1->readEntryView(stored)==nullptr); //not yet written
+    assert(z1->close()==LIBZIPPP_OK);
+    libzippp_uint64 bufferLength = z1->getBufferLength();
+    ZipArchive::free(z1);
+
+    ZipArchive* z2 = ZipArchive::fromBuffer(buffer, bufferLength);
+    assert(z2!=nullptr);
+    ZipEntry e1 = z2->getEntry("stored/data.txt");
+    const char* view = (const char*)z2->readEntryView(e1);
+    assert(view!=nullptr);
+    assert(view>=(const char*)buffer && view+len<=(const char*)buffer+bufferLength);
+    assert(strncmp(view, txtFile, len)==0);
+    assert(z2->readEntryView(z2->getEntry("deflated.txt"))==nullptr);
+    ZipArchive::free(z2);
+
+    ZipArchive z3("test.zip");
+    z3.open(ZipArchive::New);
+    z3.addData("data.txt", txtFile, len);
+    assert(z3.readEntryView(z3.getEntry("data.txt"))==nullptr); //not created from a buffer
+    z3.discard();
+
+    free(buffer);
+
+    cout << " done." << endl;
+}
+
+void test28() {
+    cout << "Running test 28...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.setEntryIndexEnabled(true);
+    assert(z1.isEntryIndexEnabled());
+    z1.open(ZipArchive::New);
+    z1.addData("folder/Data.txt", txtFile, len);
+    z1.addData("other.txt", txtFile, len);
+    assert(z1.hasEntry("folder/"));
+    assert(z1.hasEntry("folder/Data.txt"));
+    assert(!z1.hasEntry("folder/data.txt"));
+    assert(z1.hasEntry("folder/data.txt", false, false));
+    assert(z1.hasEntry("Data.txt", true));
+
+    const char* names = "other.txtfolder/Data.txt";
+    assert(z1.locateEntry(names, 9)==(libzippp_int64)z1.getEntry("other.txt").getIndex());
+    assert(z1.locateEntry(names, 8)==-1);
+    assert(z1.locateEntry(names+9, 15)==(libzippp_int64)z1.getEntry("folder/Data.txt").getIndex());
+
+    assert(z1.renameEntry("other.txt", "moved/other.txt")==1);
+    assert(!z1.hasEntry("other.txt"));
+    assert(z1.hasEntry("moved/other.txt"));
+    assert(z1.deleteEntry("folder/")==2);
+    assert(!z1.hasEntry("folder/Data.txt"));
+    assert(!z1.hasEntry("folder/"));
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    z2.setEntryIndexEnabled(true);
+    assert(z2.getNbEntries()==2);
+    assert(z2.hasEntry("MOVED/OTHER.TXT", false, false));
+    assert(z2.getEntry("moved/other.txt").readAsText()==txtFile);
+    z2.setEntryIndexEnabled(false);
+    assert(z2.hasEntry("MOVED/OTHER.TXT", false, false));
+    z2.close();
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test29() {
+    cout << "Running test 29...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("folder/data.txt", txtFile, len);
+    z1.addData("stored.txt", txtFile, len);
+    z1.getEntry("stored.txt").setCompressionMethod(STORE);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    vector<ZipEntry> entries = z2.getEntries();
+    ZipEntryTable table = z2.getEntryTable();
+    assert(table.size()==entries.size());
+    assert(table.size()==3);
+    assert(table.getNbDirectories()==1);
+    assert(table.getNbFiles()==2);
+    assert(table.hasOffsets());
+
+    libzippp_uint64 totalSize = 0;
+    libzippp_uint64 totalDeflatedSize = 0;
+    for(libzippp_uint64 i=0 ; i<table.size() ; ++i) {
+        const ZipEntry& entry = entries[i];
+        assert(table.getName(i)==entry.getName());
+        assert(strcmp(table.getNameData(i), entry.getName().c_str())==0);
+        assert(table.getIndex(i)==entry.getIndex());
+        assert(table.getSize(i)==entry.getSize());
+        assert(table.getDeflatedSize(i)==entry.getDeflatedSize());
+        assert(table.getCRC(i)==entry.getCRC());
+        assert(table.getDate(i)==entry.getDate());
+        assert(table.getCompressionMethod(i)==entry.getCompressionMethod());
+        assert(table.isDirectory(i)==entry.isDirectory());
+        totalSize += entry.getSize();
+        totalDeflatedSize += entry.getDeflatedSize();
+    }
+    assert(table.getTotalSize()==totalSize);
+    assert(table.getTotalDeflatedSize()==totalDeflatedSize);
+    assert(table.getNbEntries(STORE)>=1);
+    assert(table.getNbEntries(DEFLATE)>=1);
+    assert(table.getNbEntries(STORE)+table.getNbEntries(DEFLATE)==3);
+    assert(table.getOffset(0)==0);
+    z2.close();
+
+    assert(z2.getEntryTable().empty());
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test30() {
+    cout << "Running test 30...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("a.txt", txtFile, len);
+    z1.addData("b.txt", txtFile, len);
+    z1.addData("c.txt", txtFile, len);
+    z1.addData("d.txt", txtFile, len);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::Write);
+    vector<ZipEntry> entries = z2.getEntries();
+    int count = 0;
+    for(const ZipEntry& entry : z2.iterateEntries()) {
+        assert(entry.getName()==entries[count].getName());
+        assert(entry.getIndex()==entries[count].getIndex());
+        ++count;
+    }
+    assert(count==4);
+
+    count = 0;
+    for(const ZipEntry& entry : z2.iterateEntries(ZipArchive::Current, 1, 3)) {
+        assert(entry.getName()==entries[count+1].getName());
+        ++count;
+    }
+    assert(count==2);
+
+    assert(z2.deleteEntry("b.txt")==1);
+    count = 0;
+    for(const ZipEntry& entry : z2.iterateEntries()) {
+        assert(entry.getName()!="b.txt");
+        ++count;
+    }
+    assert(count==3);
+
+    count = 0;
+    for(const ZipEntry& entry : z2.iterateEntries(ZipArchive::Original)) {
+        assert(!entry.isNull());
+        ++count;
+    }
+    assert(count==4);
+
+    ZipEntryRange empty = z2.iterateEntries(ZipArchive::Current, 3, 1);
+    assert(empty.begin()==empty.end());
+    z2.discard();
+
+    ZipEntryRange closed = z2.iterateEntries();
+    assert(closed.begin()==closed.end());
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test31() {
+    cout << "Running test 31...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("assets/textures/a.png", txtFile, len);
+    z1.addData("assets/textures/sub/b.png", txtFile, len);
+    z1.addData("assets/models/m.obj", txtFile, len);
+    z1.addData("c.png", txtFile, len);
+
+    vector<ZipEntry> textures = z1.getEntriesWithPrefix("assets/textures/");
+    assert(textures.size()==4);
+    assert(textures[0].getName()=="assets/textures/");
+    assert(textures[1].getName()=="assets/textures/a.png");
+    assert(textures[2].getName()=="assets/textures/sub/");
+    assert(textures[3].getName()=="assets/textures/sub/b.png");
+    assert(z1.getEntriesWithPrefix("nothing/").empty());
+    assert(z1.getEntriesWithPrefix("").size()==z1.getEntries().size());
+
+    assert(z1.getEntriesMatching("*.png").size()==1);
+    assert(z1.getEntriesMatching("**.png").size()==3);
+    assert(z1.getEntriesMatching("assets/*/").size()==2);
+    assert(z1.getEntriesMatching("assets/textures/?.png").size()==1);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::Write);
+    assert(z2.getEntriesWithPrefix("assets/textures/").size()==4);
+    assert(z2.renameEntry("assets/textures/", "assets/images/")==4);
+    assert(z2.getEntriesWithPrefix("assets/textures/").empty());
+    assert(z2.getEntriesWithPrefix("assets/images/").size()==4);
+    assert(z2.getEntriesWithPrefix("assets/textures/", ZipArchive::Original).size()==4);
+    assert(z2.getEntriesMatching("assets/**.png", ZipArchive::Original).size()==2);
+
+    assert(z2.deleteEntry("assets/images/")==4);
+    assert(z2.getEntriesWithPrefix("assets/").size()==3);
+    assert(z2.addData("assets/images/new.png", txtFile, len));
+    assert(z2.getEntriesMatching("assets/images/*").size()==2);
+    z2.close();
+
+    ZipArchive z3("test.zip");
+    z3.open(ZipArchive::ReadOnly);
+    assert(z3.getEntriesMatching("**.png").size()==2);
+    z3.close();
+    z3.unlink();
+
+    cout << " done." << endl;
+}
+
+void test32() {
+    cout << "Running test 32...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+    const char* txtFile2 = "this is some other data";
+    int len2 = strlen(txtFile2);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("somedata", txtFile, len);
+    z1.addData("otherdata", txtFile2, len2);
+    z1.addData("empty", txtFile, 0);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    ZipEntry entry1 = z2.getEntry("somedata");
+    ZipEntry entry2 = z2.getEntry("otherdata");
+
+    char buffer[64];
+    assert(z2.readEntryInto(entry1, buffer, sizeof(buffer))==len);
+    assert(strncmp(buffer, txtFile, len)==0);
+    assert(z2.readEntryInto(entry2, buffer, 4)==4);
+    assert(strncmp(buffer, "this", 4)==0);
+    assert(z2.readEntryInto(entry1, nullptr, 10)==LIBZIPPP_ERROR_INVALID_PARAMETER);
+
+    string text;
+    assert(z2.readEntryInto(entry2, text)==LIBZIPPP_OK);
+    assert(text==txtFile2);
+    assert(z2.readEntryInto(entry1, text)==LIBZIPPP_OK);
+    assert(text==txtFile);
+    assert(z2.readEntryInto(entry1, text, ZipArchive::Current, 4)==LIBZIPPP_OK);
+    assert(text=="this");
+    assert(z2.readEntryInto(z2.getEntry("empty"), text)==LIBZIPPP_OK);
+    assert(text.empty());
+
+    vector<libzippp_uint8> binary;
+    assert(z2.readEntryInto(entry2, binary)==LIBZIPPP_OK);
+    assert(binary.size()==(size_t)len2);
+    assert(memcmp(binary.data(), txtFile2, len2)==0);
+
+    ZipArchive z3("test.zip");
+    z3.open(ZipArchive::ReadOnly);
+    assert(z3.readEntryInto(entry1, text)==LIBZIPPP_ERROR_INVALID_ENTRY);
+    assert(text.empty());
+    z3.close();
+
+    z2.close();
+    assert(z2.readEntryInto(entry1, binary)==LIBZIPPP_ERROR_NOT_OPEN);
+    assert(binary.empty());
+    assert(entry1.readAsText().empty());
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test33() {
+    cout << "Running test 33...";
+
+    string content;
+    for(int i=0 ; i<200000 ; ++i) {
+        content.append(to_string(i*7919));
+        content.append(i%3==0 ? "\n" : " ");
+    }
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("deflated.txt", content.data(), content.size());
+    z1.addData("stored.txt", content.data(), content.size());
+    z1.getEntry("stored.txt").setCompressionMethod(STORE);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    ZipEntryReader deflated(z2.getEntry("deflated.txt"), ZipArchive::Current, 65536);
+    ZipEntryReader stored(z2.getEntry("stored.txt"));
+    assert(deflated.getNbCheckpoints()==0);
+
+    char buffer[1024];
+    libzippp_uint64 offsets[] = { content.size()-10, 0, 500000, 123, content.size()/2, 999999 };
+    for(int i=0 ; i<6 ; ++i) {
+        libzippp_uint64 offset = offsets[i];
+        libzippp_uint64 expected = content.size()-offset<sizeof(buffer) ? content.size()-offset : sizeof(buffer);
+        assert(deflated.readRange(offset, buffer, sizeof(buffer))==(libzippp_int64)expected);
+        assert(content.compare(offset, expected, buffer, expected)==0);
+        assert(stored.readRange(offset, buffer, sizeof(buffer))==(libzippp_int64)expected);
+        assert(content.compare(offset, expected, buffer, expected)==0);
+    }
+    assert(deflated.getNbCheckpoints()>1);
+    assert(deflated.readRange(content.size(), buffer, sizeof(buffer))==0);
+    assert(deflated.readRange(0, nullptr, 10)==LIBZIPPP_ERROR_INVALID_PARAMETER);
+
+    ZipEntryReader noCheckpoint(z2.getEntry("deflated.txt"), ZipArchive::Current, 0);
+    assert(noCheckpoint.readRange(500000, buffer, 10)==10);
+    assert(content.compare(500000, 10, buffer, 10)==0);
+    assert(noCheckpoint.getNbCheckpoints()==0);
+    z2.close();
+
+    assert(deflated.readRange(0, buffer, 10)==LIBZIPPP_ERROR_NOT_OPEN);
+    assert(ZipEntryReader(ZipEntry()).readRange(0, buffer, 10)==LIBZIPPP_ERROR_INVALID_ENTRY);
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test34() {
+    cout << "Running test 34...";
+
+    string content;
+    for(int i=0 ; i<100000 ; ++i) {
+        content.append(to_string(i));
+        content.append("\n");
+    }
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("lines.txt", content.data(), content.size());
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    ZipEntry entry = z2.getEntry("lines.txt");
+
+    std::istream* input = entry.openStream(ZipArchive::Current, 1000);
+    assert(input!=nullptr);
+    string line;
+    int count = 0;
+    while (std::getline(*input, line)) {
+        assert(line==to_string(count));
+        ++count;
+    }
+    assert(count==100000);
+
+    input->clear();
+    input->seekg(10);
+    assert(input->tellg()==10);
+    char buffer[5000];
+    input->read(buffer, sizeof(buffer));
+    assert(input->gcount()==sizeof(buffer));
+    assert(content.compare(10, sizeof(buffer), buffer, sizeof(buffer))==0);
+    delete input;
+
+    {
+        ZipEntryStream stream(entry);
+        assert(stream.isOpen());
+        int value = -1;
+        stream >> value;
+        assert(value==0);
+        stream >> value;
+        assert(value==1);
+    }
+    z2.close();
+
+    assert(entry.openStream()==nullptr);
+    ZipEntryStream nullStream((ZipEntry()));
+    assert(!nullStream.isOpen());
+    assert(nullStream.fail());
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test35() {
+    cout << "Running test 35...";
+
+    string content;
+    for(int i=0 ; i<100000 ; ++i) {
+        content.append(to_string(i*31));
+        content.append(" ");
+    }
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("data.txt", content.data(), content.size());
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    assert(!z2.isReadAheadEnabled());
+    z2.setReadAheadEnabled(true);
+    assert(z2.isReadAheadEnabled());
+    ZipEntry entry = z2.getEntry("data.txt");
+
+    libzippp_uint64 chunkSizes[] = { 1000, 4096, content.size()-1, content.size(), content.size()*2 };
+    for(int i=0 ; i<5 ; ++i) {
+        string output;
+        int result = z2.readEntry(entry, [&output](const void* data, libzippp_uint64 size) {
+            output.append(static_cast<const char*>(data), size);
+            return true;
+        }, ZipArchive::Current, chunkSizes[i]);
+        assert(result==LIBZIPPP_OK);
+        assert(output==content);
+    }
+
+    int nbCalls = 0;
+    int result = z2.readEntry(entry, [&nbCalls](const void*, libzippp_uint64) { return ++nbCalls<3; }, ZipArchive::Current, 1000);
+    assert(result==LIBZIPPP_ERROR_OWRITE_FAILURE);
+    assert(nbCalls==3);
+
+    //the exceptions of the output function are propagated once the worker has been stopped
+    bool thrown = false;
+    try {
+        z2.readEntry(entry, [&thrown](const void*, libzippp_uint64) -> bool { throw std::runtime_error("output"); }, ZipArchive::Current, 1000);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(z2.getEntry("data.txt").readAsText()==content);
+
+    std::ofstream ofUnzippedFile("test35.txt");
+    assert(entry.readContent(ofUnzippedFile, ZipArchive::Current, 2048)==LIBZIPPP_OK);
+    ofUnzippedFile.close();
+    std::ifstream ifUnzippedFile("test35.txt");
+    string unzipped((std::istreambuf_iterator<char>(ifUnzippedFile)), std::istreambuf_iterator<char>());
+    ifUnzippedFile.close();
+    assert(unzipped==content);
+    remove("test35.txt");
+
+    z2.close();
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test36() {
+    cout << "Running test 36...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+    const char* txtFile2 = "this is some other data";
+    int len2 = strlen(txtFile2);
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("a.txt", txtFile, len);
+    z1.addData("b.txt", txtFile2, len2);
+    z1.addData("c.txt", txtFile, len);
+    z1.close();
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::Write);
+    assert(z2.getEntryCacheSize()==0);
+    assert(z2.getEntry("a.txt").readAsText()==txtFile);
+    assert(z2.getEntryCacheMisses()==0); //disabled
+
+    z2.setEntryCacheSize(len+len2);
+    ZipEntry a = z2.getEntry("a.txt");
+    ZipEntry b = z2.getEntry("b.txt");
+    ZipEntry c = z2.getEntry("c.txt");
+    assert(a.readAsText()==txtFile);
+    assert(z2.getEntryCacheMisses()==1);
+    assert(a.readAsText()==txtFile);
+    assert(z2.getEntryCacheHits()==1);
+    assert(z2.getEntryCacheUsage()==(libzippp_uint64)len);
+
+    //the Original state is cached separately
+    assert(a.readAsText(ZipArchive::Original)==txtFile);
+    assert(z2.getEntryCacheMisses()==2);
+
+    //b evicts the least recently used entry (a in the Current state)
+    assert(b.readAsText()==txtFile2);
+    assert(z2.getEntryCacheMisses()==3);
+    assert(z2.getEntryCacheUsage()==(libzippp_uint64)(len+len2));
+    assert(a.readAsText(ZipArchive::Original)==txtFile);
+    assert(z2.getEntryCacheHits()==2);
+    assert(a.readAsText()==txtFile);
+    assert(z2.getEntryCacheMisses()==4);
+    assert(b.readAsText()==txtFile2);
+    assert(z2.getEntryCacheMisses()==5);
+
+    //partial reads don't fill the cache
+    char buffer[4];
+    assert(z2.readEntryInto(c, buffer, sizeof(buffer))==4);
+    assert(z2.getEntryCacheMisses()==6);
+    assert(z2.readEntryInto(c, buffer, sizeof(buffer))==4);
+    assert(z2.getEntryCacheMisses()==7);
+
+    //but they are served from the cache once the entry has been entirely read
+    assert(c.readAsText()==txtFile);
+    assert(z2.getEntryCacheMisses()==8);
+    assert(z2.readEntryInto(c, buffer, sizeof(buffer))==4);
+    assert(strncmp(buffer, txtFile, sizeof(buffer))==0);
+    assert(z2.getEntryCacheHits()==3);
+    assert(z2.getEntryCacheMisses()==8);
+
+    string chunks;
+    assert(z2.readEntry(a, [&chunks](const void* data, libzippp_uint64 size) {
+        chunks.append(static_cast<const char*>(data), size);
+        return true;
+    }, ZipArchive::Current, 3)==LIBZIPPP_OK);
+    assert(chunks==txtFile);
+    assert(z2.getEntryCacheMisses()==8); //the chunked reads don't fill the cache
+
+    //replaced entry
+    assert(z2.addData("a.txt", txtFile2, len2));
+    assert(z2.getEntry("a.txt").readAsText()==txtFile2);
+    assert(z2.deleteEntry("a.txt")==1);
+
+    z2.clearEntryCache();
+    assert(z2.getEntryCacheUsage()==0);
+    assert(z2.getEntryCacheHits()==0);
+    assert(z2.getEntryCacheMisses()==0);
+    z2.discard();
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test37() {
+    cout << "Running test 37...";
+
+    string content;
+    for(int i=0 ; i<5000 ; ++i) { content += "this is some compressible data "; }
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    std::ofstream file("test37.txt", ios::binary);
+    file << content;
+    file.close();
+
+    ZipArchive z1("test.zip");
+    z1.setCompressionThreads(4);
+    assert(z1.getCompressionThreads()==4);
+    z1.open(ZipArchive::New);
+    for(int i=0 ; i<20 ; ++i) {
+        assert(z1.addData("data/file"+to_string(i)+".txt", content.c_str(), content.size()));
+    }
+    assert(z1.addFile("file.txt", "test37.txt"));
+    assert(z1.addData("small.txt", txtFile, len));
+    assert(z1.addData("empty.txt", txtFile, 0));
+
+    //the entries are still readable before being compressed
+    assert(z1.getEntry("data/file3.txt").readAsText()==content);
+
+    //overwritten, deleted and stored entries
+    assert(z1.addData("data/file1.txt", txtFile, len));
+    assert(z1.deleteEntry("data/file2.txt")==1);
+    ZipEntry stored = z1.getEntry("data/file4.txt");
+    assert(stored.setCompressionMethod(STORE));
+    assert(z1.close()==LIBZIPPP_OK);
+    remove("test37.txt");
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    assert(z2.getNbEntries()==23);
+    assert(!z2.hasEntry("data/file2.txt"));
+    assert(z2.getEntry("data/file1.txt").readAsText()==txtFile);
+    assert(z2.getEntry("small.txt").readAsText()==txtFile);
+    assert(z2.getEntry("empty.txt").readAsText().empty());
+
+    ZipEntry s = z2.getEntry("data/file4.txt");
+    assert(s.getCompressionMethod()==STORE);
+    assert(s.readAsText()==content);
+
+    const char* names[] = { "data/file0.txt", "data/file19.txt", "file.txt" };
+    for(int i=0 ; i<3 ; ++i) {
+        ZipEntry entry = z2.getEntry(names[i]);
+        assert(entry.getCompressionMethod()==DEFLATE);
+        assert(entry.getSize()==content.size());
+        assert(entry.getDeflatedSize()<entry.getSize());
+        assert(entry.readAsText()==content);
+    }
+    z2.close();
+    z2.unlink();
+
+    cout << " done." << endl;
+}
+
+void test38() {
+    cout << "Running test 38...";
+
+    string content;
+    for(int i=0 ; i<5000 ; ++i) { content += "this is some compressible data "; }
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+
+    ZipArchive z1("test.zip");
+    z1.setEagerCompressionEnabled(true);
+    assert(z1.isEagerCompressionEnabled());
+    assert(z1.getCompressionThreads()==0); //a single worker
+    z1.open(ZipArchive::New);
+    for(int i=0 ; i<10 ; ++i) {
+        char* data = static_cast<char*>(malloc(content.size()));
+        memcpy(data, content.c_str(), content.size());
+        assert(z1.addData("file"+to_string(i)+".txt", data, content.size(), true));
+    }
+    assert(z1.getEntry("file5.txt").readAsText()==content);
+
+    //the compression of replaced and deleted entries is dropped
+    assert(z1.addData("file0.txt", txtFile, len));
+    assert(z1.deleteEntry("file1.txt")==1);
+    assert(z1.close()==LIBZIPPP_OK);
+
+    ZipArchive z2("test.zip");
+    z2.open(ZipArchive::ReadOnly);
+    assert(z2.getNbEntries()==9);
+    assert(z2.getEntry("file0.txt").readAsText()==txtFile);
+    for(int i=2 ; i<10 ; ++i) {
+        ZipEntry entry = z2.getEntry("file"+to_string(i)+".txt");
+        assert(entry.getCompressionMethod()==DEFLATE);
+        assert(entry.getDeflatedSize()<entry.getSize());
+        assert(entry.readAsText()==content);
+    }
+    z2.close();
+    z2.unlink();
+
+    //the compressed data counts in the pending data, the next entries are spilled
+    ZipArchive z3("test.zip");
+    z3.setEagerCompressionEnabled(true);
+    z3.setPendingDataLimit(4*content.size());
+    z3.open(ZipArchive::New);
+    for(int i=0 ; i<10 ; ++i) { assert(z3.addData("file"+to_string(i)+".txt", content.c_str(), content.size())); }
+    assert(z3.close()==LIBZIPPP_OK);
+
+    z3.open(ZipArchive::ReadOnly);
+    assert(z3.getNbEntries()==10);
+    for(int i=0 ; i<10 ; ++i) { assert(z3.getEntry("file"+to_string(i)+".txt").readAsText()==content); }
+    z3.close();
+    z3.unlink();
+
+    cout << " done." << endl;
+}
+
+void test39() {
+    cout << "Running test 39...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+    string content;
+    for(int i=0 ; i<5000 ; ++i) { content += "this is some compressible data "; }
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("a.txt", txtFile, len);
+    z1.addData("folder/b.txt", content.c_str(), content.size());
+    z1.setComment("archive comment");
+    z1.close();
+
+    //new entries only: written after the existing ones
+    ZipArchive z2("test.zip");
+    z2.setAppendCommitEnabled(true);
+    assert(z2.isAppendCommitEnabled());
+    z2.open(ZipArchive::Write);
+    assert(z2.addData("folder/c.txt", content.c_str(), content.size()));
+    assert(z2.addData("new/d.txt", txtFile, len));
+    assert(z2.addEntry("empty/"));
+    assert(z2.deleteEntry("new/d.txt")==1); //not added anymore
+    ZipEntry stored = z2.getEntry("folder/c.txt");
+    assert(stored.setCompressionMethod(STORE));
+    assert(z2.close()==LIBZIPPP_OK);
+    assert(z2.isLastCommitAppended());
+
+    ZipArchive z3("test.zip");
+    z3.setAppendCommitEnabled(true);
+    z3.open(ZipArchive::Write, true);
+    assert(z3.getNbEntries()==6);
+    assert(z3.getComment()=="archive comment");
+    assert(z3.getEntry("a.txt").readAsText()==txtFile);
+    assert(z3.getEntry("folder/b.txt").readAsText()==content);
+    assert(z3.getEntry("folder/c.txt").getCompressionMethod()==STORE);
+    assert(z3.getEntry("folder/c.txt").readAsText()==content);
+    assert(z3.getEntry("empty/").isDirectory());
+    assert(z3.hasEntry("new/"));
+    assert(!z3.hasEntry("new/d.txt"));
+
+    //deletion of an existing entry: committed by libzip
+    assert(z3.deleteEntry("a.txt")==1);
+    assert(z3.addData("e.txt", txtFile, len));
+    assert(z3.close()==LIBZIPPP_OK);
+    assert(!z3.isLastCommitAppended());
+
+    ZipArchive z4("test.zip");
+    z4.open(ZipArchive::ReadOnly, true);
+    assert(z4.getNbEntries()==6);
+    assert(!z4.hasEntry("a.txt"));
+    assert(z4.getEntry("e.txt").readAsText()==txtFile);
+    assert(z4.getEntry("folder/c.txt").readAsText()==content);
+    z4.close();
+    z4.unlink();
+
+    cout << " done." << endl;
+}
+
+//Unix mode saved in the central record of an entry, zero if not found
+static unsigned int readUnixMode(const string& zipFile, const string& entryName) {
+    std::ifstream input(zipFile.c_str(), ios::binary);
+    string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    for(string::size_type i=0 ; i+46<=data.size() ; ++i) {
+        if (data.compare(i, 4, "PK\x01\x02")!=0) { continue; }
+        string::size_type nameLength = bytes[i+28] | (bytes[i+29]<<8);
+        if (bytes[i+5]!=3 || data.compare(i+46, nameLength, entryName)!=0) { continue; } //made by Unix
+        return (bytes[i+40] | (bytes[i+41]<<8)); //high word of the external attributes
+    }
+    return 0;
+}
+
+void test40() {
+    cout << "Running test 40...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+    string content;
+    for(int i=0 ; i<5000 ; ++i) { content += "this is some compressible data "; }
+
+    std::ofstream output("test.zip", ios::binary);
+    ZipStreamWriter w1(output);
+    w1.setComment("streamed");
+    assert(w1.addData("folder/a.txt", txtFile, len));
+    assert(w1.addEntry("empty/"));
+    assert(w1.setCompressionMethod(STORE));
+    assert(w1.getCompressionMethod()==STORE);
+    assert(w1.addData("b.txt", content.c_str(), content.size()));
+#ifdef ZIP_CM_BZIP2
+    assert(!w1.setCompressionMethod(BZIP2));
+#endif
+    assert(w1.setCompressionMethod(DEFLATE));
+    assert(w1.openEntry("folder/c.txt"));
+    assert(!w1.openEntry("d.txt")); //one entry at a time
+    for(string::size_type i=0 ; i<content.size() ; i+=1000) {
+        assert(w1.writeEntryData(content.c_str()+i, content.size()-i<1000 ? content.size()-i : 1000));
+    }
+    assert(w1.closeEntry());
+    assert(!w1.addData("folder/", txtFile, len));
+    assert(w1.finish()==LIBZIPPP_OK);
+    assert(w1.isFinished());
+    assert(!w1.addData("late.txt", txtFile, len));
+    assert(w1.getNbEntries()==5);
+    output.close();
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::ReadOnly, true);
+    assert(z1.getNbEntries()==5);
+    assert(z1.getComment()=="streamed");
+    assert(z1.getEntry("folder/").isDirectory());
+    assert(z1.getEntry("empty/").isDirectory());
+    assert(z1.getEntry("folder/a.txt").readAsText()==txtFile);
+    assert(z1.getEntry("b.txt").getCompressionMethod()==STORE);
+    assert(z1.getEntry("b.txt").readAsText()==content);
+    ZipEntry c = z1.getEntry("folder/c.txt");
+    assert(c.getCompressionMethod()==DEFLATE);
+    assert(c.getDeflatedSize()<c.getSize());
+    assert(c.readAsText()==content);
+    z1.close();
+    z1.unlink();
+
+    //through a write function
+    string buffer;
+    {
+        ZipStreamWriter w2([&buffer](const void* data, libzippp_uint64 size) {
+            buffer.append(static_cast<const char*>(data), size);
+            return true;
+        });
+        assert(w2.addData("a.txt", txtFile, len));
+        assert(w2.openEntry("b.txt", len)); //no Zip64 fields
+        assert(w2.writeEntryData(txtFile, len));
+        assert(w2.closeEntry());
+    } //finished when destroyed
+
+    ZipArchive* z2 = ZipArchive::fromBuffer(buffer.data(), buffer.size());
+    assert(z2!=nullptr);
+    assert(z2->getNbEntries()==2);
+    assert(z2->getEntry("a.txt").readAsText()==txtFile);
+    assert(z2->getEntry("b.txt").readAsText()==txtFile);
+    ZipArchive::free(z2);
+
+#ifndef _WIN32
+    //the mode of the added files is kept
+    std::ofstream("test40.txt") << txtFile;
+    chmod("test40.txt", 0750);
+    {
+        std::ofstream output3("test.zip", ios::binary);
+        ZipStreamWriter w3(output3);
+        assert(w3.addFile("test40.txt", "test40.txt"));
+        assert(w3.addData("data.txt", txtFile, len));
+        assert(w3.finish()==LIBZIPPP_OK);
+    }
+    assert((readUnixMode("test.zip", "test40.txt") & 0777)==0750);
+    assert((readUnixMode("test.zip", "data.txt") & 0777)==0666);
+    remove("test40.txt");
+    remove("test.zip");
+#endif
+
+    cout << " done." << endl;
+}
+
+void test41() {
+    cout << "Running test 41...";
+
+    const char* txtFile = "this is some data";
+    int len = strlen(txtFile);
+    string content;
+    for(int i=0 ; i<5000 ; ++i) { content += "this is some compressible data "; }
+
+    //sizes in the local headers
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.addData("folder/a.txt", txtFile, len);
+    z1.addData("b.txt", content.c_str(), content.size());
+    z1.close();
+
+    std::ifstream input1("test.zip", ios::binary);
+    ZipStreamReader r1(input1);
+    assert(r1.read(nullptr, 0)==LIBZIPPP_ERROR_INVALID_ENTRY);
+    assert(r1.nextEntry()==1);
+    assert(r1.getName()=="folder/");
+    assert(r1.isDirectory());
+    assert(r1.nextEntry()==1);
+    assert(r1.getName()=="folder/a.txt");
+    assert(!r1.hasDataDescriptor());
+    assert(r1.getSize()==(libzippp_uint64)len);
+    assert(r1.readAsText()==txtFile);
+    assert(r1.nextEntry()==1); //skipped without being read
+    assert(r1.getName()=="b.txt");
+    assert(r1.nextEntry()==0);
+    assert(r1.nextEntry()==0);
+    assert(r1.getNbEntries()==3);
+    input1.close();
+    z1.unlink();
+
+    //sizes in the data descriptors, read by small chunks
+    std::ofstream output("test.zip", ios::binary);
+    ZipStreamWriter w(output);
+    assert(w.addData("a.txt", txtFile, len));
+    assert(w.setCompressionMethod(STORE));
+    assert(w.addData("b.txt", content.c_str(), content.size()));
+    assert(w.addData("c.txt", "PK\x07\x08PK\x07\x08", 8)); //looks like a data descriptor
+    assert(w.finish()==LIBZIPPP_OK);
+    output.close();
+
+    std::ifstream input2("test.zip", ios::binary);
+    ZipStreamReader r2([&input2](void* data, libzippp_uint64 size) -> libzippp_int64 {
+        input2.read(static_cast<char*>(data), size<100 ? size : 100);
+        return input2.gcount();
+    });
+    assert(r2.nextEntry()==1);
+    assert(r2.getCompressionMethod()==DEFLATE);
+    assert(r2.hasDataDescriptor());
+    assert(r2.getSize()==0);
+    std::ostringstream text;
+    assert(r2.readContent(text, 5)==LIBZIPPP_OK);
+    assert(text.str()==txtFile);
+    assert(r2.getSize()==(libzippp_uint64)len);
+    assert(r2.nextEntry()==1);
+    assert(r2.getCompressionMethod()==STORE);
+    assert(r2.readAsText()==content);
+    assert(r2.getDeflatedSize()==content.size());
+    assert(r2.nextEntry()==1);
+    assert(r2.getName()=="c.txt");
+    assert(r2.readAsText()==string("PK\x07\x08PK\x07\x08", 8));
+    assert(r2.nextEntry()==0);
+    input2.close();
+    remove("test.zip");
+
+    cout << " done." << endl;
+}
+
+void test42() {
+    cout << "Running test 42...";
+
+    string content;
+    for(int i=0 ; i<20000 ; ++i) { content += to_string(i*7919) + ";"; }
+
+    //the buffer is extended to the size of the archive
+    void* buffer = calloc(16, sizeof(char));
+    ZipArchive* z1 = ZipArchive::fromWritableBuffer(&buffer, 16, ZipArchive::New);
+    assert(z1!=nullptr);
+    z1->setCompressionMethod(STORE);
+    assert(z1->addData("data.txt", content.c_str(), content.size()));
+    assert(z1->close()==LIBZIPPP_OK);
+    libzippp_uint64 length = z1->getBufferLength();
+    assert(length>content.size());
+    ZipArchive::free(z1);
+
+    ZipArchive* z2 = ZipArchive::fromBuffer(buffer, length, true);
+    assert(z2!=nullptr);
+    assert(z2->getEntry("data.txt").readAsText()==content);
+    ZipArchive::free(z2);
+
+    //the buffer is not reallocated if it is large enough
+    void* largeBuffer = calloc(length*2, sizeof(char));
+    void* largeBufferStart = largeBuffer;
+    ZipArchive* z3 = ZipArchive::fromWritableBuffer(&largeBuffer, length*2, ZipArchive::New);
+    assert(z3!=nullptr);
+    z3->setCompressionMethod(STORE);
+    assert(z3->addData("data.txt", content.c_str(), content.size()));
+    assert(z3->close()==LIBZIPPP_OK);
+    assert(z3->getBufferLength()==length);
+    assert(largeBuffer==largeBufferStart);
+    ZipArchive::free(z3);
+
+    free(buffer);
+    free(largeBuffer);
+
+    cout << " done." << endl;
+}
+
+void test43() {
+    cout << "Running test 43...";
+
+    //more than 65535 entries: the Zip64 end of central directory is used
+    libzippp_uint64 nbEntries = 0x10000+10;
+    void* buffer = nullptr;
+    ZipArchive* z1 = ZipArchive::fromWritableBuffer(&buffer, 0, ZipArchive::New);
+    assert(z1!=nullptr);
+    z1->setCompressionMethod(STORE);
+    for(libzippp_uint64 i=0 ; i<nbEntries ; ++i) {
+        assert(z1->addData(to_string(i), "data", 4));
+    }
+    assert(z1->close()==LIBZIPPP_OK);
+    libzippp_uint64 length = z1->getBufferLength();
+    ZipArchive::free(z1);
+
+    ZipArchive* z2 = ZipArchive::fromBuffer(buffer, length, true);
+    assert(z2!=nullptr);
+    assert(z2->getNbEntries()==(libzippp_int64)nbEntries);
+    ZipEntry last = z2->getEntry(to_string(nbEntries-1));
+    assert(last.readAsText()=="data");
+    ZipEntryTable table = z2->getEntryTable();
+    assert(table.size()==nbEntries);
+    ZipArchive::free(z2);
+
+    ZipArchive* z3 = ZipArchive::fromWritableBuffer(&buffer, length, ZipArchive::Write);
+    assert(z3!=nullptr);
+    assert(z3->deleteEntry("0")==1);
+    assert(z3->close()==LIBZIPPP_OK);
+    assert(z3->getBufferLength()<length);
+    ZipArchive::free(z3);
+
+    free(buffer);
+
+    cout << " done." << endl;
+}
+
+void test44() {
+    cout << "Running test 44...";
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    {
+        //the data is released by the caller before the archive is written
+        vector<libzippp_uint8> vec(100000, 'v');
+        assert(z1.addData("vector.bin", std::move(vec)));
+        assert(vec.empty());
+
+        string str(50000, 's');
+        assert(z1.addData("dir/string.txt", std::move(str)));
+
+        std::unique_ptr<libzippp_uint8[]> ptr(new libzippp_uint8[3]);
+        ptr[0] = 'a'; ptr[1] = 'b'; ptr[2] = 'c';
+        assert(z1.addData("unique.bin", std::move(ptr), 3));
+        assert(ptr==nullptr);
+
+        std::basic_string<libzippp_uint8> bin(1000, 'b');
+        assert(z1.addData("binary.bin", bin));
+
+        assert(!z1.addData("dir/", string("not allowed")));
+    }
+    assert(z1.close()==LIBZIPPP_OK);
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(z1.getEntry("vector.bin").readAsText()==string(100000, 'v'));
+    assert(z1.getEntry("dir/string.txt").readAsText()==string(50000, 's'));
+    assert(z1.getEntry("unique.bin").readAsText()=="abc");
+    assert(z1.getEntry("binary.bin").readAsText()==string(1000, 'b'));
+    z1.close();
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
+void test45() {
+    cout << "Running test 45...";
+
+    string content;
+    for(int i=0 ; i<10000 ; ++i) { content += "this is some streamed data "; }
+    std::istringstream input(content);
+
+    //10MB generated by chunks
+    libzippp_uint64 generated = 0;
+    libzippp_uint64 total = 10*1024*1024;
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    assert(z1.addStream("stream.txt", input));
+    assert(z1.addGenerator("dir/generated.bin", [&generated, total](void* data, libzippp_uint64 length) -> libzippp_int64 {
+        libzippp_uint64 n = total-generated<length ? total-generated : length;
+        memset(data, 'g', n);
+        generated += n;
+        return n;
+    }));
+    assert(!z1.addGenerator("dir/", [](void*, libzippp_uint64) -> libzippp_int64 { return 0; }));
+    assert(generated==0); //nothing is generated before close
+    assert(z1.close()==LIBZIPPP_OK);
+    assert(generated==total);
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(z1.getEntry("stream.txt").readAsText()==content);
+    ZipEntry entry = z1.getEntry("dir/generated.bin");
+    assert(entry.getSize()==total);
+    assert(entry.readAsText()==string(total, 'g'));
+    z1.close();
+
+    //a failing generator makes close fail
+    z1.open(ZipArchive::New);
+    assert(z1.addGenerator("failure.bin", [](void*, libzippp_uint64) -> libzippp_int64 { return -1; }));
+    assert(z1.close()!=LIBZIPPP_OK);
+    z1.discard();
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
+void test46() {
+    cout << "Running test 46...";
+
+    string content1(60000, 'a');
+    string content2(60000, 'b');
+    string content3(60000, 'c');
+    char* allocated = (char*)malloc(60000);
+    memset(allocated, 'd', 60000);
+
+    ZipArchive z1("test.zip");
+    z1.setPendingDataLimit(100000);
+    assert(z1.getPendingDataLimit()==100000);
+    z1.open(ZipArchive::New);
+    assert(z1.addData("first.txt", content1.c_str(), content1.size()));
+    assert(z1.getPendingDataSize()==60000);
+    assert(z1.addData("second.txt", content2.c_str(), content2.size())); //spilled
+    assert(z1.getPendingDataSize()==60000);
+    assert(z1.addData("third.txt", string(content3)));
+    assert(z1.addData("fourth.txt", allocated, 60000, true)); //freed once spilled
+    assert(z1.getPendingDataSize()==60000);
+    content2.assign(60000, 'x'); //the spilled data isn't needed anymore
+
+    //the data of the overwritten and deleted entries isn't pending anymore
+    assert(z1.addData("first.txt", string(content1))); //spilled
+    assert(z1.getPendingDataSize()==0);
+    assert(z1.addData("fifth.txt", content1.c_str(), content1.size()));
+    assert(z1.getPendingDataSize()==60000);
+    assert(z1.deleteEntry("fifth.txt")==1);
+    assert(z1.getPendingDataSize()==0);
+    assert(z1.close()==LIBZIPPP_OK);
+    assert(z1.getPendingDataSize()==0);
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(!z1.hasEntry("fifth.txt"));
+    assert(z1.getEntry("second.txt").readAsText()==string(60000, 'b'));
+    assert(z1.getEntry("third.txt").readAsText()==content3);
+    assert(z1.getEntry("fourth.txt").readAsText()==string(60000, 'd'));
+    z1.close();
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
+void test47() {
+    cout << "Running test 47...";
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    assert(!z1.isBatchOpen());
+    z1.beginBatch(1000000000);
+    assert(z1.isBatchOpen());
+    assert(z1.addData("a/b/c/file1.txt", "hello", 5));
+    assert(z1.addData("a/b/c/file2.txt", "world", 5));
+    assert(z1.addData("a/b/d/file3.txt", "!", 1));
+    assert(z1.addEntry("a/b/"));
+    assert(z1.getNbEntries()==7);
+    assert(z1.deleteEntry("a/b/d/")==2);
+    assert(z1.addData("a/b/d/file4.txt", "again", 5)); //the deleted directory is created again
+    z1.endBatch();
+    assert(!z1.isBatchOpen());
+    assert(z1.addData("a/b/c/file5.txt", "later", 5));
+    assert(z1.close()==LIBZIPPP_OK);
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(z1.getNbEntries()==8);
+    assert(z1.hasEntry("a/") && z1.hasEntry("a/b/") && z1.hasEntry("a/b/c/") && z1.hasEntry("a/b/d/"));
+    assert(z1.getEntry("a/b/c/file1.txt").readAsText()=="hello");
+    assert(z1.getEntry("a/b/d/file4.txt").readAsText()=="again");
+    assert(z1.getEntry("a/b/c/file1.txt").getDate()==1000000000);
+    assert(z1.getEntry("a/b/c/").getDate()==1000000000);
+    assert(z1.getEntry("a/b/c/file5.txt").getDate()>1000000000);
+    z1.close();
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
+void test48() {
+    cout << "Running test 48...";
+
+    mkdir("test48", 0777);
+    mkdir("test48/src", 0777);
+    mkdir("test48/src/util", 0777);
+    mkdir("test48/empty", 0777);
+    mkdir("test48/obj", 0777);
+    std::ofstream("test48/main.cpp") << "int main() {}";
+    std::ofstream("test48/src/a.cpp") << "void a() {}";
+    std::ofstream("test48/src/util/b.cpp") << "void b() {}";
+    std::ofstream("test48/obj/main.o") << "binary";
+#ifndef _WIN32
+    chmod("test48/src/a.cpp", 0750);
+#endif
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    assert(z1.addDirectory("test48", "project") == LIBZIPPP_ERROR_INVALID_PARAMETER);
+    assert(z1.addDirectory("test48-missing") == LIBZIPPP_ERROR_INVALID_PARAMETER);
+    int added = z1.addDirectory("test48", "project/", [](const string& path) { return path!="obj/"; });
+    assert(added==3);
+    assert(!z1.isBatchOpen());
+    assert(z1.close()==LIBZIPPP_OK);
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(z1.getNbEntries()==7);
+    assert(z1.hasEntry("project/"));
+    assert(z1.hasEntry("project/empty/"));
+    assert(z1.hasEntry("project/src/util/"));
+    assert(!z1.hasEntry("project/obj/"));
+    assert(!z1.hasEntry("project/obj/main.o"));
+    assert(z1.getEntry("project/main.cpp").readAsText()=="int main() {}");
+    assert(z1.getEntry("project/src/a.cpp").readAsText()=="void a() {}");
+    assert(z1.getEntry("project/src/util/b.cpp").readAsText()=="void b() {}");
+    z1.close();
+#ifndef _WIN32
+    assert((readUnixMode("test.zip", "project/src/a.cpp") & 0777)==0750);
+#endif
+    z1.unlink();
+
+    remove("test48/main.cpp");
+    remove("test48/src/a.cpp");
+    remove("test48/src/util/b.cpp");
+    remove("test48/obj/main.o");
+    rmdir("test48/src/util");
+    rmdir("test48/src");
+    rmdir("test48/empty");
+    rmdir("test48/obj");
+    rmdir("test48");
+
+    cout << " done." << endl;
+}
+
+class CountingInflateBackend : public ZipInflateBackend {
+public:
+    CountingInflateBackend(bool f) : failing(f), calls(0) {}
+
+    bool inflate(const void* input, libzippp_uint64 inputLength, void* output, libzippp_uint64 outputLength) const {
+        ++calls;
+        return !failing && ZipInflateBackend::zlib()->inflate(input, inputLength, output, outputLength);
+    }
+
+    bool failing;
+    mutable int calls;
+};
+
+void test49() {
+    cout << "Running test 49...";
+
+    string content;
+    for(int i=0 ; i<20000 ; ++i) { content += "line " + to_string(i%100) + "\n"; }
+
+    ZipArchive z1("test.zip");
+    z1.open(ZipArchive::New);
+    z1.setCompressionMethod(DEFLATE);
+    z1.addData("content.txt", content.c_str(), content.size());
+    z1.addData("empty.txt", "", 0);
+    z1.close();
+
+    z1.open(ZipArchive::ReadOnly);
+    assert(z1.getInflateBackend()==ZipInflateBackend::zlib());
+    assert(z1.getEntry("content.txt").readAsText()==content);
+    assert(z1.getEntry("empty.txt").readAsText()=="");
+
+    CountingInflateBackend counting(false);
+    z1.setInflateBackend(&counting);
+    assert(z1.getEntry("content.txt").readAsText()==content);
+    assert(counting.calls==1);
+    assert(z1.getEntry("content.txt").readAsText(ZipArchive::Current, 100)==content.substr(0, 100)); //partial read by libzip
+    assert(counting.calls==1);
+
+    CountingInflateBackend failing(true);
+    z1.setInflateBackend(&failing);
+    assert(z1.getEntry("content.txt").readAsText()==content); //read by libzip instead
+    assert(failing.calls==1);
+
+    z1.setInflateBackend(nullptr);
+    assert(z1.getEntry("content.txt").readAsText()==content);
+    z1.close();
+
+    z1.setInflateBackend(&counting);
+    z1.open(ZipArchive::Write);
+    assert(z1.getEntry("content.txt").readAsText()==content); //the current state is read by libzip
+    assert(z1.getEntry("content.txt").readAsText(ZipArchive::Original)==content);
+    assert(counting.calls==2);
+    z1.close();
+    z1.unlink();
+
+    cout << " done." << endl;
+}
+
 int main() {
     test1();  test2();  test3();  test4();  test5();
     test6();  test7();  test8();  test9();  test10();
     test11(); test12(); test13(); test14(); test15();
     test16(); test17(); test18(); test19(); test20();
     test21(); test22(); test23(); test23_2(); test24();
+    test25(); test26(); test27(); test28(); test29();
+    test30(); test31(); test32(); test33(); test34(); test35(); test36();
+    test37(); test38(); test39(); test40(); test41(); test42(); test43(); test44(); test45(); test46(); test47(); test48(); test49();
     return 0;
 }
 